@@ -0,0 +1,121 @@
+#include "hdf5.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "../h5attr.h"
+#include "../h5meta.h"
+
+/*
+ ** Writes attributes of several types to AttrTest.h5 and checks the values that
+ ** scanHDF5file records for them, through libhdf5 and through the native reader
+ ** of h5meta.h. Variable-length strings, which the native reader leaves to
+ ** libhdf5, go to AttrVlen.h5. Exits non-zero if any value differs.
+ **/
+
+static int failures = 0;
+
+static const char *cases[][2] = {
+  {"Temperature", "273.15"},
+  {"BigEndian", "-0.5"},
+  {"size", "11.1"},
+  {"FloatArray", "1.5 2.25 3.1"},
+  {"IntArray", "1 2 3 4 5 -6"},
+  {"Count", "9007199254740993"},
+  {"Mask", "18446744073709551615"},
+  {"Shorts", "-1 0 32767"},
+  {"Bytes", "0 128 255"},
+  {"owner", "Peng"},
+  {"Names", "ab cdef g"},
+};
+
+static void write_attr(hid_t oid, const char *name, hid_t ftype, hid_t mtype, int rank,
+    const hsize_t *dims, const void *data) {
+  hid_t sid = rank == 0 ? H5Screate(H5S_SCALAR) : H5Screate_simple(rank, dims, NULL);
+  hid_t aid = H5Acreate(oid, name, ftype, sid, H5P_DEFAULT, H5P_DEFAULT);
+  H5Awrite(aid, mtype, data);
+  H5Aclose(aid);
+  H5Sclose(sid);
+}
+
+static void check_attr(hid_t oid, const char *name, const char *expected) {
+  hid_t aid = H5Aopen(oid, name, H5P_DEFAULT);
+  hid_t atype = H5Aget_type(aid);
+  hid_t aspace = H5Aget_space(aid);
+  std::string value = attr_value(aid, atype, H5Sget_simple_extent_npoints(aspace));
+  if (value != expected) {
+    printf("FAIL %s: expected \"%s\", got \"%s\"\n", name, expected, value.c_str());
+    failures++;
+  } else {
+    printf("ok   %s = %s\n", name, value.c_str());
+  }
+  H5Sclose(aspace);
+  H5Tclose(atype);
+  H5Aclose(aid);
+}
+
+static void check_native(const char *path) {
+  h5meta::Reader reader;
+  h5meta::Records records;
+  if (!reader.open(path) || !reader.scan(records)) {
+    printf("FAIL native reader on %s: %s\n", path, reader.error().c_str());
+    failures++;
+    return;
+  }
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    std::string key = std::string("h5:/#") + cases[i][0];
+    h5meta::Records::const_iterator it = records.find(key);
+    if (it == records.end() || it->second != cases[i][1]) {
+      printf("FAIL native %s: expected \"%s\", got \"%s\"\n", cases[i][0],
+          cases[i][1], it == records.end() ? "(none)" : it->second.c_str());
+      failures++;
+    } else {
+      printf("ok   native %s = %s\n", cases[i][0], it->second.c_str());
+    }
+  }
+}
+
+int main() {
+  hid_t file = H5Fcreate("AttrTest.h5", H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  hsize_t dims[2] = {2, 3};
+
+  double temperature = 273.15;
+  write_attr(file, "Temperature", H5T_IEEE_F64LE, H5T_NATIVE_DOUBLE, 0, NULL, &temperature);
+  double bigendian = -0.5;
+  write_attr(file, "BigEndian", H5T_IEEE_F64BE, H5T_NATIVE_DOUBLE, 0, NULL, &bigendian);
+  float size = 11.1f;
+  write_attr(file, "size", H5T_IEEE_F32LE, H5T_NATIVE_FLOAT, 0, NULL, &size);
+  float floats[3] = {1.5f, 2.25f, 3.1f};
+  write_attr(file, "FloatArray", H5T_IEEE_F32LE, H5T_NATIVE_FLOAT, 1, dims + 1, floats);
+  int ints[2][3] = {{1, 2, 3}, {4, 5, -6}};
+  write_attr(file, "IntArray", H5T_STD_I32LE, H5T_NATIVE_INT, 2, dims, ints);
+  long long count = 9007199254740993LL;
+  write_attr(file, "Count", H5T_STD_I64LE, H5T_NATIVE_LLONG, 0, NULL, &count);
+  unsigned long long mask = 18446744073709551615ULL;
+  write_attr(file, "Mask", H5T_STD_U64BE, H5T_NATIVE_ULLONG, 0, NULL, &mask);
+  short shorts[3] = {-1, 0, 32767};
+  write_attr(file, "Shorts", H5T_STD_I16LE, H5T_NATIVE_SHORT, 1, dims + 1, shorts);
+  unsigned char bytes[3] = {0, 128, 255};
+  write_attr(file, "Bytes", H5T_STD_U8LE, H5T_NATIVE_UCHAR, 1, dims + 1, bytes);
+
+  hid_t str = H5Tcopy(H5T_C_S1);
+  H5Tset_size(str, 4);
+  write_attr(file, "owner", str, str, 0, NULL, "Peng");
+  char names[3][4] = {{'a', 'b', 0, 0}, {'c', 'd', 'e', 'f'}, {'g', 0, 0, 0}};
+  write_attr(file, "Names", str, str, 1, dims + 1, names);
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    check_attr(file, cases[i][0], cases[i][1]);
+  H5Fclose(file);
+  check_native("AttrTest.h5");
+
+  hid_t vlen = H5Fcreate("AttrVlen.h5", H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  H5Tset_size(str, H5T_VARIABLE);
+  const char *comments[2] = {"hello", "world"};
+  write_attr(vlen, "Comments", str, str, 1, dims, comments);
+  check_attr(vlen, "Comments", "hello world");
+  H5Tclose(str);
+  H5Fclose(vlen);
+
+  printf("%s: %d failures\n", failures ? "FAILED" : "PASSED", failures);
+  return failures ? 1 : 0;
+}
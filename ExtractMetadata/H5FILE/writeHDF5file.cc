@@ -14,7 +14,238 @@
 #include<vector>
 #include <sys/time.h>
 
+/*
+ ** Corpus for checking the native reader of h5meta.h against libhdf5 with
+ ** "scanHDF5file --validate". "writeHDF5file --corpus" writes the files below
+ ** and a path.log listing them into the current directory.
+ **
+ ** Files named old_* use the earliest file format: symbol table groups (B-tree v1
+ ** and local heap) and version 1 object headers. Files named new_* are written
+ ** with H5F_LIBVER_V18 bounds: link messages, compact storage for small groups
+ ** and dense storage (fractal heap and B-tree v2) once a group or object has more
+ ** links or attributes than the compact limit. The remaining files use features
+ ** the native reader leaves to libhdf5 (external links, variable-length strings).
+ **/
+
+static void scalar_attr(hid_t oid, const char *name, hid_t ftype, hid_t mtype, const void *value) {
+  hid_t sid = H5Screate(H5S_SCALAR);
+  hid_t aid = H5Acreate2(oid, name, ftype, sid, H5P_DEFAULT, H5P_DEFAULT);
+  H5Awrite(aid, mtype, value);
+  H5Aclose(aid);
+  H5Sclose(sid);
+}
+
+static void array_attr(hid_t oid, const char *name, hid_t ftype, hid_t mtype, int rank,
+    const hsize_t *dims, const void *value) {
+  hid_t sid = H5Screate_simple(rank, dims, NULL);
+  hid_t aid = H5Acreate2(oid, name, ftype, sid, H5P_DEFAULT, H5P_DEFAULT);
+  H5Awrite(aid, mtype, value);
+  H5Aclose(aid);
+  H5Sclose(sid);
+}
+
+static void string_attr(hid_t oid, const char *name, const char *value) {
+  hid_t type = H5Tcopy(H5T_C_S1);
+  H5Tset_size(type, strlen(value) + 1);
+  scalar_attr(oid, name, type, type, value);
+  H5Tclose(type);
+}
+
+/*
+ ** Layouts of the corpus datasets.
+ **/
+enum { CONTIGUOUS, CHUNKED, COMPACT, SCALAR, DEFLATE, EMPTY };
+
+static hid_t corpus_dataset(hid_t gid, const char *name, int layout, hid_t type) {
+  hsize_t dims[3] = {40, 30, 5};
+  hsize_t maxdims[3] = {H5S_UNLIMITED, 30, 5};
+  hsize_t chunk[3] = {7, 11, 5};
+  hsize_t compact[1] = {4};
+  static int data[40 * 30 * 5];
+  hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+  hid_t sid;
+  switch (layout) {
+    case CHUNKED:
+      H5Pset_chunk(dcpl, 3, chunk);
+      sid = H5Screate_simple(3, dims, maxdims);
+      break;
+    case DEFLATE:
+      H5Pset_chunk(dcpl, 3, chunk);
+      H5Pset_deflate(dcpl, 6);
+      sid = H5Screate_simple(3, dims, maxdims);
+      break;
+    case COMPACT:
+      H5Pset_layout(dcpl, H5D_COMPACT);
+      sid = H5Screate_simple(1, compact, NULL);
+      break;
+    case SCALAR:
+      sid = H5Screate(H5S_SCALAR);
+      break;
+    default:
+      sid = H5Screate_simple(2, dims, NULL);
+      break;
+  }
+  hid_t did = H5Dcreate2(gid, name, type, sid, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+  if (layout != EMPTY && H5Tequal(type, H5T_NATIVE_INT) > 0) {
+    for (int i = 0; i < 40 * 30 * 5; i++)
+      data[i] = i % 17;
+    H5Dwrite(did, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
+  }
+  H5Sclose(sid);
+  H5Pclose(dcpl);
+  return did;
+}
+
+/*
+ ** Features beyond the common content of every corpus file.
+ **/
+enum { PLAIN, NAMED_TYPE, EXTERNAL_LINK, VLEN_STRING };
+
+static void fill_corpus_file(hid_t file, int nchildren, int nattrs, int extra) {
+  hid_t root = H5Gopen2(file, "/", H5P_DEFAULT);
+  int version = 3;
+  scalar_attr(root, "version", H5T_STD_I32LE, H5T_NATIVE_INT, &version);
+  string_attr(root, "creator", "corpus");
+
+  // Attributes of every class and byte order the native reader formats
+  hid_t grp = H5Gcreate2(file, "/grp", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  for (int i = 0; i < nattrs; i++) {
+    char name[32];
+    int value = i * 7 - 3;
+    sprintf(name, "attr%03d", i);
+    scalar_attr(grp, name, H5T_STD_I32LE, H5T_NATIVE_INT, &value);
+  }
+  hsize_t dims3[1] = {3};
+  hsize_t dims23[2] = {2, 3};
+  float floats[3] = {1.5f, 2.25f, -3.125f};
+  int ints[6] = {1, -2, 3, 40, 500, 6000};
+  double kelvin = 273.15;
+  long long big = -9007199254740993LL;
+  unsigned long long mask = 18446744073709551615ULL;
+  short shorts[3] = {-1, 0, 32767};
+  unsigned char bytes[3] = {0, 128, 255};
+  array_attr(grp, "floats", H5T_IEEE_F32LE, H5T_NATIVE_FLOAT, 1, dims3, floats);
+  array_attr(grp, "ints", H5T_STD_I32LE, H5T_NATIVE_INT, 2, dims23, ints);
+  scalar_attr(grp, "kelvin", H5T_IEEE_F64LE, H5T_NATIVE_DOUBLE, &kelvin);
+  scalar_attr(grp, "kelvinBE", H5T_IEEE_F64BE, H5T_NATIVE_DOUBLE, &kelvin);
+  scalar_attr(grp, "big", H5T_STD_I64LE, H5T_NATIVE_LLONG, &big);
+  scalar_attr(grp, "maskBE", H5T_STD_U64BE, H5T_NATIVE_ULLONG, &mask);
+  array_attr(grp, "shortsBE", H5T_STD_I16BE, H5T_NATIVE_SHORT, 1, dims3, shorts);
+  array_attr(grp, "bytes", H5T_STD_U8LE, H5T_NATIVE_UCHAR, 1, dims3, bytes);
+
+  // Enough children to move the group to dense storage in new_* files
+  for (int i = 0; i < nchildren; i++) {
+    char name[32];
+    sprintf(name, "member_%05d", i);
+    if (i % 3 == 0) {
+      hid_t child = H5Gcreate2(grp, name, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+      float scale = 0.5f * i;
+      scalar_attr(child, "scale", H5T_IEEE_F32LE, H5T_NATIVE_FLOAT, &scale);
+      H5Gclose(child);
+    } else {
+      hid_t did = corpus_dataset(grp, name, i % 6, H5T_NATIVE_INT);
+      scalar_attr(did, "Temperature", H5T_STD_I32LE, H5T_NATIVE_INT, &i);
+      H5Dclose(did);
+    }
+  }
+
+  // Intermediate groups, and one dataset of every layout and class
+  hid_t lcpl = H5Pcreate(H5P_LINK_CREATE);
+  H5Pset_create_intermediate_group(lcpl, 1);
+  hid_t sub = H5Gcreate2(grp, "deep/er/est", lcpl, H5P_DEFAULT, H5P_DEFAULT);
+  H5Gclose(H5Gcreate2(grp, "a/b/c", lcpl, H5P_DEFAULT, H5P_DEFAULT));
+  H5Pclose(lcpl);
+  hid_t did = corpus_dataset(sub, "IntArray", CONTIGUOUS, H5T_NATIVE_INT);
+  float size = 11.1f;
+  array_attr(did, "Temperature", H5T_STD_I32LE, H5T_NATIVE_INT, 2, dims23, ints);
+  scalar_attr(did, "size", H5T_IEEE_F32LE, H5T_NATIVE_FLOAT, &size);
+  string_attr(did, "owner", "Peng");
+  H5Dclose(did);
+  H5Dclose(corpus_dataset(sub, "Chunked", CHUNKED, H5T_NATIVE_INT));
+  H5Dclose(corpus_dataset(sub, "Gzip", DEFLATE, H5T_NATIVE_INT));
+  H5Dclose(corpus_dataset(sub, "Empty", EMPTY, H5T_NATIVE_DOUBLE));
+  H5Dclose(corpus_dataset(sub, "Compact", COMPACT, H5T_NATIVE_INT));
+  H5Dclose(corpus_dataset(sub, "Scalar", SCALAR, H5T_NATIVE_FLOAT));
+  hid_t strtype = H5Tcopy(H5T_C_S1);
+  H5Tset_size(strtype, 16);
+  H5Dclose(corpus_dataset(sub, "Strings", CONTIGUOUS, strtype));
+  H5Tclose(strtype);
+  hid_t comptype = H5Tcreate(H5T_COMPOUND, 8);
+  H5Tinsert(comptype, "a", 0, H5T_NATIVE_INT);
+  H5Tinsert(comptype, "b", 4, H5T_NATIVE_FLOAT);
+  H5Dclose(corpus_dataset(sub, "Compound", CONTIGUOUS, comptype));
+  H5Tclose(comptype);
+  H5Gclose(sub);
+
+  // A soft link and a second hard link to one dataset
+  H5Lcreate_soft("/grp/deep/er/est/IntArray", grp, "soft", H5P_DEFAULT, H5P_DEFAULT);
+  H5Lcreate_hard(grp, "deep/er/est/Chunked", root, "hardlink", H5P_DEFAULT, H5P_DEFAULT);
+
+  if (extra == NAMED_TYPE) {
+    hid_t type = H5Tcopy(H5T_NATIVE_INT);
+    H5Tcommit2(root, "named_type", type, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    H5Tclose(type);
+  } else if (extra == EXTERNAL_LINK) {
+    H5Lcreate_external("other.h5", "/x", root, "ext", H5P_DEFAULT, H5P_DEFAULT);
+  } else if (extra == VLEN_STRING) {
+    hid_t type = H5Tcopy(H5T_C_S1);
+    const char *value = "vlen";
+    H5Tset_size(type, H5T_VARIABLE);
+    scalar_attr(root, "vs", type, type, &value);
+    H5Tclose(type);
+  }
+  H5Gclose(grp);
+  H5Gclose(root);
+}
+
+static void write_corpus() {
+  struct {
+    const char *name;
+    bool latest;    // H5F_LIBVER_V18 bounds
+    hsize_t userblock;
+    bool smallsizes; // 4-byte offsets and lengths
+    int nchildren;
+    int nattrs;
+    int extra;
+  } files[] = {
+    {"old_small.h5", false, 0, false, 10, 3, PLAIN},
+    {"old_many.h5", false, 0, false, 3000, 5, PLAIN},
+    {"old_userblock.h5", false, 1024, false, 50, 3, PLAIN},
+    {"old_sizes4.h5", false, 0, true, 200, 3, PLAIN},
+    {"old_named_type.h5", false, 0, false, 10, 3, NAMED_TYPE},
+    {"new_compact.h5", true, 0, false, 5, 4, PLAIN},
+    {"new_dense.h5", true, 0, false, 60, 40, PLAIN},
+    {"new_many.h5", true, 0, false, 20000, 300, PLAIN},
+    {"new_userblock.h5", true, 512, false, 100, 12, PLAIN},
+    {"new_named_type.h5", true, 0, false, 10, 3, NAMED_TYPE},
+    {"external.h5", true, 0, false, 10, 3, EXTERNAL_LINK},
+    {"vlen.h5", false, 0, false, 10, 3, VLEN_STRING},
+  };
+  std::ofstream paths("path.log");
+  for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+    hid_t fcpl = H5Pcreate(H5P_FILE_CREATE);
+    hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
+    if (files[i].latest)
+      H5Pset_libver_bounds(fapl, H5F_LIBVER_V18, H5F_LIBVER_V18);
+    if (files[i].userblock)
+      H5Pset_userblock(fcpl, files[i].userblock);
+    if (files[i].smallsizes)
+      H5Pset_sizes(fcpl, 4, 4);
+    hid_t file = H5Fcreate(files[i].name, H5F_ACC_TRUNC, fcpl, fapl);
+    fill_corpus_file(file, files[i].nchildren, files[i].nattrs, files[i].extra);
+    H5Fclose(file);
+    H5Pclose(fapl);
+    H5Pclose(fcpl);
+    paths << files[i].name << std::endl;
+  }
+  printf("Write HDF5 corpus succeed\n");
+}
+
 int main(int argc, char *argv[]) {
+  if (argc > 1 && strcmp(argv[1], "--corpus") == 0) {
+    write_corpus();
+    return 0;
+  }
   printf("Write HDF5 file\n");
   hid_t file, dataset, datatype, dataspace;
   hsize_t dimsf[2];
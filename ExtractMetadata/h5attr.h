@@ -0,0 +1,94 @@
+/*
+ ** Formatting of HDF5 attribute values, shared by scanHDF5file and its tests.
+ **/
+#ifndef H5ATTR_H
+#define H5ATTR_H
+
+#include "hdf5.h"
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/*
+ **  Format every element of an attribute, separated by blanks.
+ **  Numbers are read through the native long long / double types, so integers of any
+ **  size and sign and both float precisions convert exactly; floats print with the
+ **  digits their stored precision holds (FLT_DIG or DBL_DIG).
+ **  Other classes give an empty value.
+ **/
+inline std::string attr_value(hid_t aid, hid_t atype, size_t npoints) {
+	std::string value;
+	char num[64];
+	if (npoints == 0)
+		return value;
+	switch (H5Tget_class(atype)) {
+		case H5T_INTEGER:
+		{
+			if (H5Tget_sign(atype) == H5T_SGN_NONE) {
+				std::vector<unsigned long long> ints(npoints);
+				if (H5Aread(aid, H5T_NATIVE_ULLONG, ints.data()) < 0)
+					break;
+				for (size_t i = 0; i < npoints; i++) {
+					snprintf(num, sizeof(num), "%s%llu", i ? " " : "", ints[i]);
+					value.append(num);
+				}
+			} else {
+				std::vector<long long> ints(npoints);
+				if (H5Aread(aid, H5T_NATIVE_LLONG, ints.data()) < 0)
+					break;
+				for (size_t i = 0; i < npoints; i++) {
+					snprintf(num, sizeof(num), "%s%lld", i ? " " : "", ints[i]);
+					value.append(num);
+				}
+			}
+			break;
+		}
+		case H5T_FLOAT:
+		{
+			int digits = H5Tget_size(atype) <= sizeof(float) ? FLT_DIG : DBL_DIG;
+			std::vector<double> floats(npoints);
+			if (H5Aread(aid, H5T_NATIVE_DOUBLE, floats.data()) < 0)
+				break;
+			for (size_t i = 0; i < npoints; i++) {
+				snprintf(num, sizeof(num), "%s%.*g", i ? " " : "", digits, floats[i]);
+				value.append(num);
+			}
+			break;
+		}
+		case H5T_STRING:
+		{
+			if (H5Tis_variable_str(atype) > 0) {
+				std::vector<char *> strs(npoints);
+				if (H5Aread(aid, atype, strs.data()) < 0)
+					break;
+				for (size_t i = 0; i < npoints; i++) {
+					if (i)
+						value.append(" ");
+					if (strs[i])
+						value.append(strs[i]);
+				}
+				hid_t aspace = H5Aget_space(aid);
+				H5Dvlen_reclaim(atype, aspace, H5P_DEFAULT, strs.data());
+				H5Sclose(aspace);
+			} else {
+				size_t size = H5Tget_size(atype);
+				std::vector<char> chars(npoints * size);
+				if (H5Aread(aid, atype, chars.data()) < 0)
+					break;
+				for (size_t i = 0; i < npoints; i++) {
+					if (i)
+						value.append(" ");
+					value.append(&chars[i * size], strnlen(&chars[i * size], size));
+				}
+			}
+			break;
+		}
+		default:
+			break;
+	}
+	return value;
+}
+
+#endif
@@ -0,0 +1,931 @@
+/*
+ ** h5meta.h: a read-only HDF5 metadata reader that does not use libhdf5.
+ **
+ ** libhdf5 serializes every call behind one global lock, so threads cannot scan
+ ** files in parallel. This reader maps the file and walks the superblock, object
+ ** headers, link and attribute messages, symbol table groups (B-tree v1 + local
+ ** heap) and dense storage (B-tree v2 + fractal heap) itself. All state lives in
+ ** a Reader, so any number of Readers can run on different threads.
+ **
+ ** It produces the same "h5:<object path>#<attribute>" records as the libhdf5
+ ** path of scanHDF5file.cc. Whenever a file uses something it does not decode
+ ** (shared or committed messages, external links, layout versions other than 3,
+ ** variable-length attributes, numeric attributes other than 1/2/4/8-byte integers
+ ** and IEEE single or double floats, filtered or huge heap objects), scan()
+ ** returns false and the caller falls back to libhdf5.
+ ** Checksums are not verified and a little-endian host is assumed.
+ **/
+#ifndef H5META_H
+#define H5META_H
+
+#include <fcntl.h>
+#include <float.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace h5meta {
+
+typedef std::map<std::string, std::string> Records;
+
+/*
+ ** Add one record of an object. Trailing blanks are dropped so values compare
+ ** as written.
+ **/
+inline void add_record(Records &records, const std::string &objname,
+    const std::string &attr, const std::string &value) {
+	std::string key = "h5:";
+	key.append(objname).append("#").append(attr);
+	std::string tvalue(value);
+	while (!tvalue.empty() && tvalue[tvalue.length() - 1] == ' ')
+		tvalue.erase(tvalue.length() - 1);
+	records[key] = tvalue;
+}
+
+class Reader {
+public:
+	Reader() : data(NULL), size(0), base(0), so(8), sl(8) {}
+	~Reader() { close(); }
+
+	/*
+	 ** Map a file, returns false if it cannot be opened.
+	 **/
+	bool open(const char *path) {
+		close();
+		int fd = ::open(path, O_RDONLY);
+		if (fd < 0) {
+			err = "cannot open file";
+			return false;
+		}
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0) {
+			::close(fd);
+			err = "cannot stat file";
+			return false;
+		}
+		void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (p == MAP_FAILED) {
+			err = "cannot map file";
+			return false;
+		}
+		data = (const unsigned char *)p;
+		size = (uint64_t)st.st_size;
+		return true;
+	}
+
+	void close() {
+		if (data != NULL)
+			munmap((void *)data, (size_t)size);
+		data = NULL;
+		size = 0;
+	}
+
+	/*
+	 ** Extract the records of all groups and datasets of the mapped file.
+	 ** Returns false if the file needs libhdf5, records are then incomplete.
+	 **/
+	bool scan(Records &records) {
+		if (data == NULL)
+			return false;
+		try {
+			uint64_t root = superblock();
+			std::vector<uint64_t> parents;
+			scan_group("/", root, records, parents);
+		} catch (const Unsupported &e) {
+			err = e.why;
+			return false;
+		}
+		return true;
+	}
+
+	/*
+	 ** Why the last open() or scan() failed.
+	 **/
+	const std::string &error() const { return err; }
+
+private:
+	struct Unsupported {
+		std::string why;
+		explicit Unsupported(const std::string &w) : why(w) {}
+	};
+
+	/* A message inside an object header: type, flags and absolute position */
+	struct Msg {
+		unsigned type;
+		unsigned flags;
+		uint64_t pos;
+		uint64_t len;
+	};
+
+	struct Link {
+		std::string name;
+		uint64_t addr;
+	};
+
+	struct Space {
+		std::vector<uint64_t> dims;
+		uint64_t npoints;
+	};
+
+	struct Type {
+		unsigned cls;
+		unsigned bits;
+		uint64_t size;
+		uint64_t props; /* class properties, after the 8-byte header */
+	};
+
+	/* Fractal heap parameters needed to find managed objects */
+	struct Heap {
+		unsigned idlen;
+		unsigned width;
+		uint64_t start;
+		uint64_t root;
+		unsigned rootrows;
+		unsigned offsize;
+		unsigned lensize;
+		unsigned maxdirectrows;
+		unsigned firstrowbits;
+	};
+
+	const unsigned char *data;
+	uint64_t size;
+	uint64_t base;
+	unsigned so; /* size of offsets */
+	unsigned sl; /* size of lengths */
+	std::string err;
+
+	static void fail(const std::string &why) { throw Unsupported(why); }
+
+	static unsigned log2_floor(uint64_t n) {
+		unsigned r = 0;
+		while (n >>= 1)
+			r++;
+		return r;
+	}
+
+	void need(uint64_t pos, uint64_t len) const {
+		if (pos > size || len > size - pos)
+			fail("truncated file");
+	}
+
+	uint64_t u(uint64_t pos, unsigned n) const {
+		need(pos, n);
+		uint64_t v = 0;
+		for (int i = (int)n - 1; i >= 0; i--)
+			v = (v << 8) | data[pos + i];
+		return v;
+	}
+
+	/* Read an n-byte unsigned value in the given byte order */
+	uint64_t number(uint64_t pos, unsigned n, bool bigendian) const {
+		if (!bigendian)
+			return u(pos, n);
+		need(pos, n);
+		uint64_t v = 0;
+		for (unsigned i = 0; i < n; i++)
+			v = (v << 8) | data[pos + i];
+		return v;
+	}
+
+	bool sig(uint64_t pos, const char *s) const {
+		need(pos, 4);
+		return memcmp(data + pos, s, 4) == 0;
+	}
+
+	bool undef(uint64_t addr) const {
+		return so == 8 ? addr == ~(uint64_t)0 : addr == ((uint64_t)1 << (8 * so)) - 1;
+	}
+
+	/* Absolute position of a file address */
+	uint64_t at(uint64_t addr) const {
+		if (undef(addr))
+			fail("undefined address");
+		return base + addr;
+	}
+
+	/*
+	 ** Locate the superblock, returns the address of the root group header.
+	 **/
+	uint64_t superblock() {
+		static const unsigned char signature[8] = {0x89, 'H', 'D', 'F', '\r', '\n', 0x1a, '\n'};
+		uint64_t p = 0;
+		while (p + 8 > size || memcmp(data + p, signature, 8) != 0) {
+			p = p == 0 ? 512 : p * 2;
+			if (p + 8 > size)
+				fail("no superblock");
+		}
+		unsigned version = (unsigned)u(p + 8, 1);
+		uint64_t q;
+		uint64_t root;
+		if (version <= 1) {
+			so = (unsigned)u(p + 13, 1);
+			sl = (unsigned)u(p + 14, 1);
+			q = p + 24 + (version == 1 ? 4 : 0);
+			check_sizes();
+			base = u(q, so);
+			/* skip base, free space, end of file and driver addresses, then the
+			 ** link name offset of the root symbol table entry */
+			root = u(q + 5 * so, so);
+		} else if (version <= 3) {
+			so = (unsigned)u(p + 9, 1);
+			sl = (unsigned)u(p + 10, 1);
+			q = p + 12;
+			check_sizes();
+			base = u(q, so);
+			root = u(q + 3 * so, so);
+		} else {
+			fail("superblock version");
+		}
+		return root;
+	}
+
+	void check_sizes() const {
+		if ((so != 2 && so != 4 && so != 8) || (sl != 2 && sl != 4 && sl != 8))
+			fail("offset or length size");
+	}
+
+	/*
+	 ** Collect the messages of an object header, following continuations.
+	 **/
+	void read_header(uint64_t addr, std::vector<Msg> &msgs) const {
+		uint64_t p = at(addr);
+		std::vector<std::pair<uint64_t, uint64_t> > chunks;
+		bool v2 = sig(p, "OHDR");
+		unsigned hflags = 0;
+		if (v2) {
+			if (u(p + 4, 1) != 2)
+				fail("object header version");
+			hflags = (unsigned)u(p + 5, 1);
+			uint64_t q = p + 6;
+			if (hflags & 0x20)
+				q += 16;
+			if (hflags & 0x10)
+				q += 4;
+			unsigned n = 1u << (hflags & 3);
+			chunks.push_back(std::make_pair(q + n, u(q, n)));
+		} else {
+			if (u(p, 1) != 1)
+				fail("object header version");
+			chunks.push_back(std::make_pair(p + 16, u(p + 8, 4)));
+		}
+		for (size_t c = 0; c < chunks.size(); c++) {
+			if (chunks.size() > 4096)
+				fail("too many header chunks");
+			uint64_t q = chunks[c].first;
+			uint64_t end = q + chunks[c].second;
+			need(q, chunks[c].second);
+			unsigned mhdr = v2 ? 4 + ((hflags & 4) ? 2 : 0) : 8;
+			while (q + mhdr <= end) {
+				Msg m;
+				if (v2) {
+					m.type = (unsigned)u(q, 1);
+					m.len = u(q + 1, 2);
+					m.flags = (unsigned)u(q + 3, 1);
+				} else {
+					m.type = (unsigned)u(q, 2);
+					m.len = u(q + 2, 2);
+					m.flags = (unsigned)u(q + 4, 1);
+				}
+				m.pos = q + mhdr;
+				if (m.pos + m.len > end)
+					fail("message overruns header");
+				q = m.pos + m.len;
+				if (m.type == 0x10) {
+					/* continuation: address and length of the next chunk */
+					uint64_t cp = at(u(m.pos, so));
+					uint64_t clen = u(m.pos + so, sl);
+					if (v2) {
+						if (!sig(cp, "OCHK") || clen < 8)
+							fail("bad continuation chunk");
+						chunks.push_back(std::make_pair(cp + 4, clen - 8));
+					} else {
+						chunks.push_back(std::make_pair(cp, clen));
+					}
+				} else if (m.type != 0) {
+					msgs.push_back(m);
+				}
+			}
+		}
+	}
+
+	Space read_space(uint64_t p) const {
+		Space s;
+		unsigned version = (unsigned)u(p, 1);
+		unsigned rank = (unsigned)u(p + 1, 1);
+		unsigned type;
+		uint64_t q;
+		if (version == 1) {
+			type = rank > 0 ? 1 : 0;
+			q = p + 8;
+		} else if (version == 2) {
+			type = (unsigned)u(p + 3, 1);
+			q = p + 4;
+		} else {
+			fail("dataspace version");
+		}
+		s.npoints = type == 2 ? 0 : 1;
+		if (type == 1) {
+			for (unsigned i = 0; i < rank; i++) {
+				s.dims.push_back(u(q + (uint64_t)i * sl, sl));
+				s.npoints *= s.dims.back();
+			}
+		}
+		return s;
+	}
+
+	Type read_type(uint64_t p) const {
+		Type t;
+		t.cls = (unsigned)u(p, 1) & 0x0f;
+		t.bits = (unsigned)u(p + 1, 3);
+		t.size = u(p + 4, 4);
+		t.props = p + 8;
+		return t;
+	}
+
+	/*
+	 ** Class name as record_layout reports it.
+	 **/
+	static const char *type_name(const Type &t) {
+		switch (t.cls) {
+			case 0:  return "H5T_INTEGER";
+			case 1:  return "H5T_FLOAT";
+			case 3:  return "H5T_STRING";
+			case 4:  return "H5T_BITFIELD";
+			case 5:  return "H5T_OPAQUE";
+			case 6:  return "H5T_COMPOUND";
+			case 8:  return "H5T_ENUM";
+			case 9:  return (t.bits & 0x0f) == 1 ? "H5T_STRING" : "Other";
+			case 10: return "H5T_ARRAY";
+			default: return "Other";
+		}
+	}
+
+	/*
+	 ** Whether a float type is IEEE single or double precision, the layouts that
+	 ** libhdf5 converts to native double without loss.
+	 **/
+	bool ieee_float(const Type &t) const {
+		unsigned bits = (unsigned)t.size * 8;
+		unsigned expsize = t.size == 4 ? 8 : 11;
+		uint64_t bias = t.size == 4 ? 127 : 1023;
+		if (t.size != 4 && t.size != 8)
+			return false;
+		return !(t.bits & 0x40) && ((t.bits >> 4) & 3) == 2 && ((t.bits >> 8) & 0xff) == bits - 1
+		    && u(t.props, 2) == 0 && u(t.props + 2, 2) == bits
+		    && u(t.props + 4, 1) == bits - 1 - expsize && u(t.props + 5, 1) == expsize
+		    && u(t.props + 6, 1) == 0 && u(t.props + 7, 1) == bits - 1 - expsize
+		    && u(t.props + 8, 4) == bias;
+	}
+
+	/*
+	 ** Format an attribute value the way attr_value in h5attr.h does: every element
+	 ** separated by blanks, integers exactly and floats with FLT_DIG or DBL_DIG digits.
+	 **/
+	std::string attr_value(const Type &t, const Space &s, uint64_t p, uint64_t len) const {
+		std::string value;
+		char num[64];
+		if (s.npoints == 0)
+			return value;
+		switch (t.cls) {
+			case 0: {
+				unsigned n = (unsigned)t.size;
+				if ((n != 1 && n != 2 && n != 4 && n != 8) || u(t.props, 2) != 0
+				    || u(t.props + 2, 2) != 8 * t.size)
+					fail("integer attribute layout");
+				if (s.npoints > len / n)
+					fail("attribute data overruns message");
+				for (uint64_t i = 0; i < s.npoints; i++) {
+					uint64_t v = number(p + n * i, n, t.bits & 1);
+					if (t.bits & 8) {
+						/* Sign-extend the two's complement value */
+						if (n < 8 && ((v >> (8 * n - 1)) & 1))
+							v |= ~(uint64_t)0 << (8 * n);
+						snprintf(num, sizeof(num), "%s%lld", i ? " " : "", (long long)v);
+					} else {
+						snprintf(num, sizeof(num), "%s%llu", i ? " " : "",
+						    (unsigned long long)v);
+					}
+					value.append(num);
+				}
+				break;
+			}
+			case 1: {
+				unsigned n = (unsigned)t.size;
+				if (!ieee_float(t))
+					fail("float attribute layout");
+				if (s.npoints > len / n)
+					fail("attribute data overruns message");
+				for (uint64_t i = 0; i < s.npoints; i++) {
+					uint64_t raw = number(p + n * i, n, t.bits & 1);
+					double d;
+					if (n == 4) {
+						uint32_t r = (uint32_t)raw;
+						float f;
+						memcpy(&f, &r, sizeof(f));
+						d = f;
+					} else {
+						memcpy(&d, &raw, sizeof(d));
+					}
+					snprintf(num, sizeof(num), "%s%.*g", i ? " " : "",
+					    n == 4 ? FLT_DIG : DBL_DIG, d);
+					value.append(num);
+				}
+				break;
+			}
+			case 3: {
+				if (t.size == 0 || s.npoints > len / t.size)
+					fail("attribute data overruns message");
+				for (uint64_t i = 0; i < s.npoints; i++) {
+					const char *c = (const char *)data + p + t.size * i;
+					if (i)
+						value.append(" ");
+					value.append(c, strnlen(c, (size_t)t.size));
+				}
+				break;
+			}
+			case 9:
+				fail("variable-length attribute");
+			default:
+				break;
+		}
+		return value;
+	}
+
+	/*
+	 ** Decode an attribute message and record it.
+	 **/
+	void read_attr(const std::string &objname, uint64_t p, uint64_t len, Records &records) const {
+		unsigned version = (unsigned)u(p, 1);
+		unsigned flags = (unsigned)u(p + 1, 1);
+		uint64_t nlen = u(p + 2, 2);
+		uint64_t tlen = u(p + 4, 2);
+		uint64_t slen = u(p + 6, 2);
+		uint64_t q = p + 8;
+		if (version == 1) {
+			nlen = (nlen + 7) & ~(uint64_t)7;
+			tlen = (tlen + 7) & ~(uint64_t)7;
+			slen = (slen + 7) & ~(uint64_t)7;
+		} else if (version == 2 || version == 3) {
+			if (flags & 3)
+				fail("shared attribute datatype or dataspace");
+			if (version == 3)
+				q++;
+		} else {
+			fail("attribute version");
+		}
+		need(q, nlen);
+		std::string name((const char *)data + q, strnlen((const char *)data + q, (size_t)nlen));
+		Type t = read_type(q + nlen);
+		Space s = read_space(q + nlen + tlen);
+		uint64_t dp = q + nlen + tlen + slen;
+		if (dp > p + len)
+			fail("attribute overruns message");
+		add_record(records, objname, name, attr_value(t, s, dp, p + len - dp));
+	}
+
+	/*
+	 ** Walk a B-tree v1 group node, collecting the links of its symbol nodes.
+	 **/
+	void group_btree(uint64_t addr, uint64_t heapdata, uint64_t heapsize,
+	    std::vector<Link> &links, int depth) const {
+		if (depth > 64)
+			fail("group B-tree too deep");
+		uint64_t p = at(addr);
+		if (!sig(p, "TREE") || u(p + 4, 1) != 0)
+			fail("bad group B-tree node");
+		unsigned level = (unsigned)u(p + 5, 1);
+		unsigned n = (unsigned)u(p + 6, 2);
+		uint64_t q = p + 8 + 2 * so;
+		for (unsigned i = 0; i < n; i++) {
+			uint64_t child = u(q + sl, so);
+			if (level > 0) {
+				group_btree(child, heapdata, heapsize, links, depth + 1);
+				q += sl + so;
+				continue;
+			}
+			uint64_t sp = at(child);
+			if (!sig(sp, "SNOD"))
+				fail("bad symbol table node");
+			unsigned nsym = (unsigned)u(sp + 6, 2);
+			uint64_t e = sp + 8;
+			for (unsigned j = 0; j < nsym; j++, e += 2 * so + 24) {
+				uint64_t nameoff = u(e, so);
+				uint64_t ohdr = u(e + so, so);
+				unsigned cache = (unsigned)u(e + 2 * so, 4);
+				if (cache == 2 || undef(ohdr))
+					continue; /* soft link */
+				if (nameoff >= heapsize)
+					fail("link name outside local heap");
+				const char *c = (const char *)data + heapdata + nameoff;
+				Link l;
+				l.name.assign(c, strnlen(c, (size_t)(heapsize - nameoff)));
+				l.addr = ohdr;
+				links.push_back(l);
+			}
+			q += sl + so;
+		}
+	}
+
+	/*
+	 ** Decode a link message, external and user-defined links need libhdf5.
+	 **/
+	void read_link(uint64_t p, std::vector<Link> &links) const {
+		if (u(p, 1) != 1)
+			fail("link version");
+		unsigned flags = (unsigned)u(p + 1, 1);
+		uint64_t q = p + 2;
+		unsigned type = 0;
+		if (flags & 0x08)
+			type = (unsigned)u(q++, 1);
+		if (flags & 0x04)
+			q += 8;
+		if (flags & 0x10)
+			q++;
+		unsigned n = 1u << (flags & 3);
+		uint64_t nlen = u(q, n);
+		q += n;
+		need(q, nlen);
+		if (type == 1)
+			return; /* soft link */
+		if (type != 0)
+			fail("external or user-defined link");
+		Link l;
+		l.name.assign((const char *)data + q, (size_t)nlen);
+		l.addr = u(q + nlen, so);
+		links.push_back(l);
+	}
+
+	/*
+	 ** B-tree v2 traversal, collecting the positions of all records.
+	 **/
+	void bt2_records(uint64_t addr, std::vector<uint64_t> &recs, unsigned &recsize) const {
+		uint64_t p = at(addr);
+		if (!sig(p, "BTHD") || u(p + 4, 1) != 0)
+			fail("bad B-tree v2 header");
+		uint64_t nodesize = u(p + 6, 4);
+		recsize = (unsigned)u(p + 10, 2);
+		unsigned depth = (unsigned)u(p + 12, 2);
+		uint64_t root = u(p + 16, so);
+		unsigned rootn = (unsigned)u(p + 16 + so, 2);
+		if (recsize == 0 || nodesize <= 10 || depth > 32)
+			fail("bad B-tree v2 parameters");
+		/* Widths of the child pointer fields, as computed by H5B2__hdr_init */
+		std::vector<unsigned> cumsize(depth + 1, 0);
+		uint64_t cum = (nodesize - 10) / recsize;
+		unsigned nrecsize = log2_floor(cum) / 8 + 1;
+		for (unsigned d = 1; d <= depth; d++) {
+			uint64_t ptr = so + nrecsize + (d > 1 ? cumsize[d - 1] : 0);
+			if (nodesize < 10 + ptr)
+				fail("bad B-tree v2 parameters");
+			uint64_t maxn = (nodesize - (10 + ptr)) / (recsize + ptr);
+			cum = (maxn + 1) * cum + maxn;
+			cumsize[d] = log2_floor(cum) / 8 + 1;
+		}
+		if (!undef(root))
+			bt2_node(root, rootn, depth, recsize, nrecsize, cumsize, recs);
+	}
+
+	void bt2_node(uint64_t addr, unsigned n, unsigned depth, unsigned recsize,
+	    unsigned nrecsize, const std::vector<unsigned> &cumsize,
+	    std::vector<uint64_t> &recs) const {
+		uint64_t p = at(addr);
+		if (!sig(p, depth == 0 ? "BTLF" : "BTIN"))
+			fail("bad B-tree v2 node");
+		uint64_t q = p + 6;
+		need(q, (uint64_t)n * recsize);
+		for (unsigned i = 0; i < n; i++)
+			recs.push_back(q + (uint64_t)i * recsize);
+		if (depth == 0)
+			return;
+		q += (uint64_t)n * recsize;
+		for (unsigned i = 0; i <= n; i++) {
+			uint64_t child = u(q, so);
+			unsigned childn = (unsigned)u(q + so, nrecsize);
+			q += so + nrecsize + (depth > 1 ? cumsize[depth - 1] : 0);
+			bt2_node(child, childn, depth - 1, recsize, nrecsize, cumsize, recs);
+		}
+	}
+
+	Heap read_heap(uint64_t addr) const {
+		uint64_t p = at(addr);
+		if (!sig(p, "FRHP") || u(p + 4, 1) != 0)
+			fail("bad fractal heap header");
+		Heap h;
+		h.idlen = (unsigned)u(p + 5, 2);
+		if (u(p + 7, 2) != 0)
+			fail("filtered fractal heap");
+		uint64_t maxman = u(p + 10, 4);
+		uint64_t q = p + 14 + 2 * sl + 2 * so + 8 * sl;
+		h.width = (unsigned)u(q, 2);
+		h.start = u(q + 2, sl);
+		uint64_t maxdirect = u(q + 2 + sl, sl);
+		unsigned maxbits = (unsigned)u(q + 2 + 2 * sl, 2);
+		h.root = u(q + 6 + 2 * sl, so);
+		h.rootrows = (unsigned)u(q + 6 + 2 * sl + so, 2);
+		if (h.width == 0 || h.start == 0 || maxdirect < h.start || maxman == 0)
+			fail("bad fractal heap parameters");
+		h.offsize = (maxbits + 7) / 8;
+		h.lensize = (log2_floor(maxdirect) + 7) / 8;
+		if (log2_floor(maxman) / 8 + 1 < h.lensize)
+			h.lensize = log2_floor(maxman) / 8 + 1;
+		h.firstrowbits = log2_floor(h.start) + log2_floor(h.width);
+		h.maxdirectrows = log2_floor(maxdirect) - log2_floor(h.start) + 2;
+		return h;
+	}
+
+	uint64_t row_block_size(const Heap &h, unsigned row) const {
+		return row == 0 ? h.start : h.start << (row - 1);
+	}
+
+	void dtable_lookup(const Heap &h, uint64_t off, unsigned &row, unsigned &col) const {
+		if (off < h.start * h.width) {
+			row = 0;
+			col = (unsigned)(off / h.start);
+		} else {
+			unsigned high = log2_floor(off);
+			row = high - h.firstrowbits + 1;
+			if (row > 63)
+				fail("bad heap offset");
+			col = (unsigned)((off - ((uint64_t)1 << high)) / row_block_size(h, row));
+		}
+		if (col >= h.width)
+			fail("bad heap offset");
+	}
+
+	/*
+	 ** Find a fractal heap object by its heap ID.
+	 **/
+	void heap_object(const Heap &h, uint64_t id, uint64_t &pos, uint64_t &len) const {
+		unsigned flags = (unsigned)u(id, 1);
+		unsigned type = (flags >> 4) & 3;
+		if (type == 2) {
+			/* tiny object stored inside the ID */
+			if (h.idlen <= 18) {
+				len = (flags & 0x0f) + 1;
+				pos = id + 1;
+			} else {
+				len = (((uint64_t)flags & 0x0f) << 8 | u(id + 1, 1)) + 1;
+				pos = id + 2;
+			}
+			need(pos, len);
+			return;
+		}
+		if (type != 0)
+			fail("huge heap object");
+		uint64_t off = u(id + 1, h.offsize);
+		len = u(id + 1 + h.offsize, h.lensize);
+		uint64_t block = h.root;
+		if (h.rootrows > 0) {
+			unsigned row, col;
+			dtable_lookup(h, off, row, col);
+			int hops = 0;
+			while (row >= h.maxdirectrows) {
+				if (++hops > 64)
+					fail("fractal heap too deep");
+				block = u(indirect_entry(block, row * h.width + col, h), so);
+				uint64_t ip = at(block);
+				if (!sig(ip, "FHIB"))
+					fail("bad fractal heap indirect block");
+				uint64_t blockoff = u(ip + 5 + so, h.offsize);
+				if (off < blockoff)
+					fail("bad heap offset");
+				dtable_lookup(h, off - blockoff, row, col);
+			}
+			block = u(indirect_entry(block, row * h.width + col, h), so);
+		}
+		uint64_t dp = at(block);
+		if (!sig(dp, "FHDB"))
+			fail("bad fractal heap direct block");
+		uint64_t blockoff = u(dp + 5 + so, h.offsize);
+		if (off < blockoff)
+			fail("bad heap offset");
+		pos = dp + (off - blockoff);
+		need(pos, len);
+	}
+
+	uint64_t indirect_entry(uint64_t block, unsigned entry, const Heap &h) const {
+		uint64_t ip = at(block);
+		if (!sig(ip, "FHIB"))
+			fail("bad fractal heap indirect block");
+		return ip + 5 + so + h.offsize + (uint64_t)entry * so;
+	}
+
+	/*
+	 ** Links of a group in dense storage: name index records are a 4 byte hash
+	 ** followed by the heap ID of a link message.
+	 **/
+	void dense_links(uint64_t heapaddr, uint64_t index, std::vector<Link> &links) const {
+		Heap h = read_heap(heapaddr);
+		std::vector<uint64_t> recs;
+		unsigned recsize;
+		bt2_records(index, recs, recsize);
+		for (size_t i = 0; i < recs.size(); i++) {
+			uint64_t pos, len;
+			heap_object(h, recs[i] + 4, pos, len);
+			read_link(pos, links);
+		}
+	}
+
+	/*
+	 ** Attributes in dense storage: name index records start with the heap ID
+	 ** of an attribute message, followed by its message flags.
+	 **/
+	void dense_attrs(const std::string &objname, uint64_t heapaddr, uint64_t index,
+	    Records &records) const {
+		Heap h = read_heap(heapaddr);
+		std::vector<uint64_t> recs;
+		unsigned recsize;
+		bt2_records(index, recs, recsize);
+		for (size_t i = 0; i < recs.size(); i++) {
+			if (u(recs[i] + 8, 1) & 2)
+				fail("shared attribute");
+			uint64_t pos, len;
+			heap_object(h, recs[i], pos, len);
+			read_attr(objname, pos, len, records);
+		}
+	}
+
+	/*
+	 ** Bytes of all allocated chunks, from the v1 chunk B-tree of layout v3.
+	 **/
+	uint64_t chunk_bytes(uint64_t addr, unsigned ndims, int depth) const {
+		if (depth > 64)
+			fail("chunk B-tree too deep");
+		uint64_t p = at(addr);
+		if (!sig(p, "TREE") || u(p + 4, 1) != 1)
+			fail("bad chunk B-tree node");
+		unsigned level = (unsigned)u(p + 5, 1);
+		unsigned n = (unsigned)u(p + 6, 2);
+		uint64_t keysize = 8 + 8 * (uint64_t)ndims;
+		uint64_t q = p + 8 + 2 * so;
+		uint64_t total = 0;
+		for (unsigned i = 0; i < n; i++, q += keysize + so) {
+			if (level == 0)
+				total += u(q, 4);
+			else
+				total += chunk_bytes(u(q + keysize, so), ndims, depth + 1);
+		}
+		return total;
+	}
+
+	/*
+	 ** Record the datatype class, shape, chunking and storage of a dataset.
+	 **/
+	void read_layout(const std::string &objname, const Type &t, const Space &s,
+	    uint64_t p, Records &records) const {
+		char tmp[32];
+		add_record(records, objname, "h5.dtype", type_name(t));
+		std::string shape;
+		for (size_t i = 0; i < s.dims.size(); i++) {
+			sprintf(tmp, i == 0 ? "%llu" : "x%llu", (unsigned long long)s.dims[i]);
+			shape.append(tmp);
+		}
+		add_record(records, objname, "h5.shape", shape);
+
+		if (u(p, 1) != 3)
+			fail("layout version");
+		uint64_t storage = 0;
+		switch (u(p + 1, 1)) {
+			case 0: /* compact */
+				storage = u(p + 2, 2);
+				break;
+			case 1: { /* contiguous */
+				uint64_t addr = u(p + 2, so);
+				storage = undef(addr) ? 0 : u(p + 2 + so, sl);
+				break;
+			}
+			case 2: { /* chunked, the last dimension is the element size */
+				unsigned ndims = (unsigned)u(p + 2, 1);
+				uint64_t addr = u(p + 3, so);
+				std::string chunk;
+				for (unsigned i = 0; i + 1 < ndims; i++) {
+					sprintf(tmp, i == 0 ? "%llu" : "x%llu",
+					    (unsigned long long)u(p + 3 + so + 4 * i, 4));
+					chunk.append(tmp);
+				}
+				add_record(records, objname, "h5.chunk", chunk);
+				storage = undef(addr) ? 0 : chunk_bytes(addr, ndims, 0);
+				break;
+			}
+			default:
+				fail("layout class");
+		}
+		sprintf(tmp, "%llu", (unsigned long long)storage);
+		add_record(records, objname, "h5.storage", tmp);
+	}
+
+	/*
+	 ** Record a group and all its members, like scan_group.
+	 **/
+	void scan_group(const std::string &name, uint64_t addr, Records &records,
+	    std::vector<uint64_t> &parents) const {
+		for (size_t i = 0; i < parents.size(); i++)
+			if (parents[i] == addr)
+				fail("group cycle");
+		std::vector<Msg> msgs;
+		read_header(addr, msgs);
+		std::vector<Link> links;
+		read_object(name, msgs, records, &links);
+		parents.push_back(addr);
+		for (size_t i = 0; i < links.size(); i++) {
+			std::string child = name == "/" ? "/" + links[i].name : name + "/" + links[i].name;
+			std::vector<Msg> cmsgs;
+			read_header(links[i].addr, cmsgs);
+			if (has_msg(cmsgs, 0x11) || has_msg(cmsgs, 0x02))
+				scan_group(child, links[i].addr, records, parents);
+			else if (has_msg(cmsgs, 0x01) && has_msg(cmsgs, 0x03))
+				read_object(child, cmsgs, records, NULL);
+			/* named datatypes are not recorded */
+		}
+		parents.pop_back();
+	}
+
+	/*
+	 ** Object classes as libhdf5 tells them apart: a group has a symbol table or
+	 ** link info message, a dataset has a datatype and a dataspace.
+	 **/
+	static bool has_msg(const std::vector<Msg> &msgs, unsigned type) {
+		for (size_t i = 0; i < msgs.size(); i++)
+			if (msgs[i].type == type)
+				return true;
+		return false;
+	}
+
+	/*
+	 ** Record the attributes of an object and collect its links if it is a
+	 ** group, or record its layout if links is NULL and it is a dataset.
+	 **/
+	void read_object(const std::string &name, const std::vector<Msg> &msgs, Records &records,
+	    std::vector<Link> *links) const {
+		const Msg *space = NULL;
+		const Msg *type = NULL;
+		const Msg *layout = NULL;
+		for (size_t i = 0; i < msgs.size(); i++) {
+			const Msg &m = msgs[i];
+			if ((m.flags & 2) && (m.type == 0x01 || m.type == 0x03 || m.type == 0x0c))
+				fail("shared message");
+			switch (m.type) {
+				case 0x01: space = &m; break;
+				case 0x03: type = &m; break;
+				case 0x08: layout = &m; break;
+				case 0x0c:
+					read_attr(name, m.pos, m.len, records);
+					break;
+				case 0x15: { /* attribute info */
+					unsigned flags = (unsigned)u(m.pos + 1, 1);
+					uint64_t q = m.pos + 2 + ((flags & 1) ? 2 : 0);
+					uint64_t heap = u(q, so);
+					if (!undef(heap))
+						dense_attrs(name, heap, u(q + so, so), records);
+					break;
+				}
+				case 0x11: /* symbol table */
+					if (links != NULL) {
+						uint64_t hp = at(u(m.pos + so, so));
+						if (!sig(hp, "HEAP"))
+							fail("bad local heap");
+						uint64_t heapsize = u(hp + 8, sl);
+						uint64_t heapdata = at(u(hp + 8 + 2 * sl, so));
+						need(heapdata, heapsize);
+						group_btree(u(m.pos, so), heapdata, heapsize, *links, 0);
+					}
+					break;
+				case 0x02: /* link info */
+					if (links != NULL) {
+						unsigned flags = (unsigned)u(m.pos + 1, 1);
+						uint64_t q = m.pos + 2 + ((flags & 1) ? 8 : 0);
+						uint64_t heap = u(q, so);
+						if (!undef(heap))
+							dense_links(heap, u(q + so, so), *links);
+					}
+					break;
+				case 0x06: /* link */
+					if (links != NULL)
+						read_link(m.pos, *links);
+					break;
+				default:
+					break;
+			}
+		}
+		if (links == NULL) {
+			if (layout == NULL || type == NULL || space == NULL)
+				fail("dataset without layout");
+			read_layout(name, read_type(type->pos), read_space(space->pos), layout->pos,
+			    records);
+		}
+	}
+
+	Reader(const Reader &);
+	Reader &operator=(const Reader &);
+};
+
+} /* namespace h5meta */
+
+#endif /* H5META_H */
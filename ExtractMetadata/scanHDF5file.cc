@@ -12,14 +12,19 @@
 #include <random>
 #include <stdio.h>
 #include<vector>
+#include <algorithm>
+#include <map>
 #include <sys/time.h>
 #include "mpi.h"
 #include "Alluxio.h"
 #include "Util.h"
 #include "JNIHelper.h"
+#include "h5meta.h"
+#include "h5attr.h"
 using namespace tdms;
 
 #define MAX_NAME 1024
+#define NATIVE_BATCH 256
 //#define H5FILE_NAME    "h5file/MyFile.h5" /* get a better example file... */
 
 void do_dtype(hid_t);
@@ -27,15 +32,43 @@ void do_dset(hid_t);
 void do_link(hid_t, char *);
 void scan_group(hid_t);
 void do_attr(hid_t);
-void do_attr(hid_t aid, char*, char*);
+void do_attr(hid_t aid, char*, std::string &);
 void scan_attrs(hid_t);
 void scan_attrs(char *, hid_t);
 void do_plist(hid_t);
+void record_attrs(const char *, hid_t);
+void record_layout(const char *, hid_t, hid_t, hid_t);
+void add_record(const char *, const char *, const char *);
+void send_records(std::string &);
+void scan_file(const char *);
+void register_file(std::string, TDMSCreateFileOptions*);
+void scan_native(std::vector<std::string> &, TDMSCreateFileOptions*);
+void validate_files(std::vector<std::string> &, int, int);
 
 jTDMSFileSystem client;
 std::string tdmsPath = "/H5test";
 std::string ufsPath = "/BIGDATA/nsccgz_pcheng_1/benchmarks/UnifiedMetadata/ExtractMetadata";
 
+/*
+ ** With --project, the groups and datasets of every file are sent to the master as UDM
+ ** records keyed "h5:<object path>#<attribute>", which the master exposes as read-only
+ ** virtual inodes under the file path.
+ **/
+bool projectObjects = false;
+h5meta::Records records;
+
+/*
+ ** With --native, records are extracted by h5meta.h on all OpenMP threads
+ ** instead of libhdf5, which serializes every call behind one global lock.
+ ** Files it cannot decode fall back to libhdf5. It implies --project, since
+ ** records are all the native reader produces.
+ **
+ ** With --validate, every file is scanned by both readers and the records
+ ** are diffed; nothing is sent to the master.
+ **/
+bool nativeReader = false;
+bool validateReader = false;
+
 int main(int argc, char *argv[]) {
 
     MPI_Init(&argc, &argv);
@@ -45,6 +78,14 @@ int main(int argc, char *argv[]) {
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     if (rank == 0)
       printf("Init MPI with %d threads\n",size);
+    for (int i = 1; i < argc; i++) {
+      if (strcmp(argv[i], "--project") == 0)
+        projectObjects = true;
+      if (strcmp(argv[i], "--native") == 0)
+        nativeReader = projectObjects = true;
+      if (strcmp(argv[i], "--validate") == 0)
+        validateReader = true;
+    }
 
     //Init TDMS env
     TDMSClientContext acc;
@@ -60,34 +101,28 @@ int main(int argc, char *argv[]) {
       buf.push_back(s);
     }
     if (rank == 0)
-      printf("Num of string is %d\n", buf.size());
+      printf("Num of string is %zu\n", buf.size());
 
-    hid_t    file;
-    hid_t    grp;
+    if (validateReader) {
+      validate_files(buf, rank, size);
+      MPI_Finalize();
+      return 0;
+    }
 
-    herr_t   status;
- 
     /*
      **  Example: open a file, open the root, scan the whole file.
      **/
-    std::string filepath;
-    for(int i = rank; i < buf.size(); i += size) {
-      const char *tmpfile = buf[i].data();
-      printf("Rank %d processing Path : %s\n", rank, tmpfile);
-      file = H5Fopen(tmpfile, H5F_ACC_RDWR, H5P_DEFAULT);
-      grp = H5Gopen(file, "/", H5P_DEFAULT);
-      scan_group(grp);
-      printf("Size of ufs path is %d\n", ufsPath.length());
-      if (buf[i].find(ufsPath) < buf[i].length()) {
-        filepath = buf[i].replace(0, ufsPath.length(), tdmsPath);
-      } else {
-        filepath = buf[i];
+    std::vector<std::string> mine;
+    for(size_t i = rank; i < buf.size(); i += size)
+      mine.push_back(buf[i]);
+    if (nativeReader) {
+      scan_native(mine, options);
+    } else {
+      for (size_t i = 0; i < mine.size(); i++) {
+        printf("Rank %d processing Path : %s\n", rank, mine[i].data());
+        scan_file(mine[i].data());
+        register_file(mine[i], options);
       }
-      jFileOutStream fileOutStream = client->createFile((char*) filepath.data(), options);
-      fileOutStream->close();
-      client->setDatasetInfo((char*) filepath.data());
-      std::cout << "Path of file is " << filepath << std::endl;
-      status = H5Fclose(file);
     }
   
     MPI_Finalize();
@@ -125,6 +160,8 @@ void scan_group(hid_t gid) {
          **  process the attributes of the group, if any.
          **/
         scan_attrs(gid);
+        if (projectObjects)
+          record_attrs(group_name, gid);
 
         /*
          **  Get all the members of the groups, one at a time.
@@ -221,6 +258,13 @@ void do_dset(hid_t did) {
 	do_plist(pid);
 	size = H5Dget_storage_size(did);
 	printf("Total space currently written in file: %d\n",(int)size);
+        if (projectObjects) {
+          record_layout(ds_name, sid, tid, pid);
+          char tmpsize[32];
+          sprintf(tmpsize, "%llu", (unsigned long long)size);
+          add_record(ds_name, "h5.storage", tmpsize);
+          record_attrs(ds_name, did);
+        }
         printf("\n");
         printf("\n");
 
@@ -307,20 +351,18 @@ void scan_attrs(char* datasetName, hid_t oid) {
         hid_t aid;
         int i;
         na = H5Aget_num_attrs(oid);
-        char* key[na];
-        char* value[na];
+        char key[MAX_NAME];
+        std::string value;
         //key[1] = "aaa";
         //printf("key is %s", key[1]);
         //char key[128];
         //char value[128];
         for (i = 0; i < na; i++) {
-                key[i] = (char *)malloc(128 * sizeof(char));
-                value[i] = (char *)malloc(128 * sizeof(char));
                 aid =   H5Aopen_idx(oid, (unsigned int)i );
-                do_attr(aid, key[i], value[i]);
+                do_attr(aid, key, value);
                 //do_attr(aid, &key[0], &value[0]);
                 //do_attr(aid);
-                printf("Attribute key is %s, value is %s\n", key[i], value[i]);
+                printf("Attribute key is %s, value is %s\n", key, value.c_str());
                 H5Aclose(aid);
         }
         //client->addDatasetInfo(datasetName,  key, value, na);
@@ -342,75 +384,16 @@ void scan_attrs(hid_t oid) {
  * Process one attribute.  
  * This is similar to the information about a dataset.
  */
-void do_attr(hid_t aid, char* key, char* value) {
-        ssize_t len;
+void do_attr(hid_t aid, char* key, std::string &value) {
         hid_t atype;
         hid_t aspace;
-        char buf[MAX_NAME]; 
-        int   rank;
-        herr_t ret;
-
-        static std::string attributeV;
-        char tmpvalue[8];
 
-        //len = H5Aget_name(aid, MAX_NAME, buf );
-        //printf("  Attribute Name : %s\n",buf);
-        len = H5Aget_name(aid, MAX_NAME, key);
+        H5Aget_name(aid, MAX_NAME, key);
 
         aspace = H5Aget_space(aid); /* the dimensions of the attribute data */
-        rank = H5Sget_simple_extent_ndims(aspace); /*Determines the dimensionality of a dataspace*/
-        hsize_t sdim[64];
-        ret = H5Sget_simple_extent_dims(aspace, sdim, NULL); /*Retrieves dataspace dimension size and maximaximum size*/
-
-
-
         atype  = H5Aget_type(aid);
         size_t npoints = H5Sget_simple_extent_npoints(aspace);
-
-	switch(H5Tget_class(atype)) { /*Class type: https://support.hdfgroup.org/HDF5/doc/RM/RM_H5T.html#Datatype-GetClass*/
-          case H5T_INTEGER :
-          {
-            //printf("  Attribute Type : H5T_INTEGER \n");
-            int* int_array = (int *)malloc(sizeof(int)*(int)npoints);
-            ret = H5Aread(aid, atype, int_array);
-            for(int i = 0; i < (int)npoints; i++) {
-              sprintf(tmpvalue, "%d ", int_array[i]);
-              attributeV.append(tmpvalue);
-            }
-            sprintf(value, "%s", (char*)attributeV.data());
-            printf("%s\n",value);
-            attributeV = "";
-            free(int_array);
-            break;
-          }
-          case H5T_FLOAT :
-          {
-            //printf("  Attribute Type : H5T_FLOAT \n");
-            float* float_array = (float *)malloc(sizeof(float)*(int)npoints);
-            ret = H5Aread(aid, atype, float_array);
-            for(int i = 0; i < (int)npoints; i++)
-               sprintf(value, "%f ", float_array[i]);
-            //printf("\n");
-            free(float_array);
-            break;
-          }
-          case H5T_STRING :
-          {
-
-            hsize_t sz = H5Aget_storage_size(aid);
-
-            char* char_array = new char[sz+1];
-            ret = H5Aread(aid, atype, (void *)char_array);
-            //ret = H5Aread(aid, atype, (void *)value);
-            sprintf(value, "%s", char_array);
-            free(char_array);
-            break;
-          }
-          default:
-          {
-            printf("UNKNOWN TYPE\n");
-          }
-        }         
+        value = attr_value(aid, atype, npoints);
         H5Tclose(atype);
         H5Sclose(aspace);
 }
@@ -456,46 +439,18 @@ void do_attr(hid_t aid) {
         /*List the value of the attribute*/
         switch(H5Tget_class(atype)) { /*Class type: https://support.hdfgroup.org/HDF5/doc/RM/RM_H5T.html#Datatype-GetClass*/
           case H5T_INTEGER :
-          {
             printf("  Attribute Type : H5T_INTEGER \n");
-            int* int_array = (int *)malloc(sizeof(int)*(int)npoints);
-            ret = H5Aread(aid, atype, int_array);
-            printf("  Attribute Values : ");
-            for(int i = 0; i < (int)npoints; i++)
-              printf("%d ", int_array[i]);
-            printf("\n");
-            free(int_array);
             break;
-          }
           case H5T_FLOAT :
-          {
             printf("  Attribute Type : H5T_FLOAT \n");
-            float* float_array = (float *)malloc(sizeof(float)*(int)npoints);
-            ret = H5Aread(aid, atype, float_array);
-            printf("  Attribute Values : ");
-            for(int i = 0; i < (int)npoints; i++)
-               printf("%f ", float_array[i]);
-            printf("\n");
-            free(float_array);
             break;
-          }
           case H5T_STRING :
-          {
-            printf("  Attribute Type : H5T_STRING");
-            hsize_t sz = H5Aget_storage_size(aid);
-            printf(", String size is %d\n",sz);
-            char* char_array = new char[sz+1];
-            ret = H5Aread(aid, atype, (void *)char_array);
-            printf("  Attribute Values : ");
-            printf("%s\n",char_array);
-            free(char_array);
+            printf("  Attribute Type : H5T_STRING, String size is %d\n", (int)H5Tget_size(atype));
             break;
-          }
           default: 
-          {
             printf("UNKNOWN TYPE\n");
-          }
         }
+        printf("  Attribute Values : %s\n", attr_value(aid, atype, npoints).c_str());
 
 	/*
          ** The datatype and dataspace can be used to read all or
@@ -645,3 +600,201 @@ void do_plist(hid_t pid) {
 	}
 	/* ... and so on for other dataset properties ... */
 }
+
+/*
+ **  Add one record of an object to the projection of the current file.
+ **  Trailing blanks of space-padded strings are dropped so values compare as written.
+ **/
+void add_record(const char *objname, const char *attr, const char *value) {
+	h5meta::add_record(records, objname, attr, value);
+}
+
+/*
+ **  Record the attributes of a group or dataset.
+ **/
+void record_attrs(const char *objname, hid_t oid) {
+	int na;
+	hid_t aid;
+	char key[MAX_NAME];
+	std::string value;
+	na = H5Aget_num_attrs(oid);
+	for (int i = 0; i < na; i++) {
+		aid = H5Aopen_idx(oid, (unsigned int)i);
+		do_attr(aid, key, value);
+		add_record(objname, key, value.c_str());
+		H5Aclose(aid);
+	}
+}
+
+/*
+ **  Record the datatype class, shape and chunking of a dataset.
+ **/
+void record_layout(const char *objname, hid_t sid, hid_t tid, hid_t pid) {
+	const char *tname;
+	switch (H5Tget_class(tid)) {
+		case H5T_INTEGER:  tname = "H5T_INTEGER"; break;
+		case H5T_FLOAT:    tname = "H5T_FLOAT"; break;
+		case H5T_STRING:   tname = "H5T_STRING"; break;
+		case H5T_BITFIELD: tname = "H5T_BITFIELD"; break;
+		case H5T_OPAQUE:   tname = "H5T_OPAQUE"; break;
+		case H5T_COMPOUND: tname = "H5T_COMPOUND"; break;
+		case H5T_ARRAY:    tname = "H5T_ARRAY"; break;
+		case H5T_ENUM:     tname = "H5T_ENUM"; break;
+		default:           tname = "Other"; break;
+	}
+	add_record(objname, "h5.dtype", tname);
+
+	hsize_t dims[H5S_MAX_RANK];
+	char tmpdim[32];
+	std::string shape;
+	int rank = H5Sget_simple_extent_dims(sid, dims, NULL);
+	for (int i = 0; i < rank; i++) {
+		sprintf(tmpdim, i == 0 ? "%llu" : "x%llu", (unsigned long long)dims[i]);
+		shape.append(tmpdim);
+	}
+	add_record(objname, "h5.shape", shape.data());
+
+	if (H5D_CHUNKED == H5Pget_layout(pid)) {
+		std::string chunk;
+		int rank_chunk = H5Pget_chunk(pid, H5S_MAX_RANK, dims);
+		for (int i = 0; i < rank_chunk; i++) {
+			sprintf(tmpdim, i == 0 ? "%llu" : "x%llu", (unsigned long long)dims[i]);
+			chunk.append(tmpdim);
+		}
+		add_record(objname, "h5.chunk", chunk.data());
+	}
+}
+
+/*
+ **  Send the records of the current file to the master and reset them.
+ **/
+void send_records(std::string &filepath) {
+	int n = records.size();
+	if (n == 0)
+		return;
+	std::vector<char*> key(n);
+	std::vector<char*> value(n);
+	int i = 0;
+	for (h5meta::Records::iterator it = records.begin();
+	    it != records.end(); ++it, ++i) {
+		key[i] = (char*) it->first.data();
+		value[i] = (char*) it->second.data();
+	}
+	client->addDatasetInfo((char*) filepath.data(), key.data(), value.data(), n);
+	printf("Projected %d records of %s\n", n, filepath.data());
+	records.clear();
+}
+
+/*
+ **  Scan one file with libhdf5, recording its objects when projecting.
+ **/
+void scan_file(const char *path) {
+	hid_t file = H5Fopen(path, H5F_ACC_RDWR, H5P_DEFAULT);
+	hid_t grp = H5Gopen(file, "/", H5P_DEFAULT);
+	scan_group(grp);
+	H5Gclose(grp);
+	H5Fclose(file);
+}
+
+/*
+ **  Create a scanned file in TDMS and send its records.
+ **/
+void register_file(std::string path, TDMSCreateFileOptions* options) {
+	std::string filepath;
+	printf("Size of ufs path is %zu\n", ufsPath.length());
+	if (path.find(ufsPath) < path.length()) {
+		filepath = path.replace(0, ufsPath.length(), tdmsPath);
+	} else {
+		filepath = path;
+	}
+	jFileOutStream fileOutStream = client->createFile((char*) filepath.data(), options);
+	fileOutStream->close();
+	client->setDatasetInfo((char*) filepath.data());
+	if (projectObjects)
+		send_records(filepath);
+	std::cout << "Path of file is " << filepath << std::endl;
+}
+
+/*
+ **  Extract the records of a batch of files in parallel with h5meta.h, then
+ **  register them one by one. The TDMS client is only used from this thread.
+ **/
+void scan_native(std::vector<std::string> &paths, TDMSCreateFileOptions* options) {
+	for (size_t start = 0; start < paths.size(); start += NATIVE_BATCH) {
+		int n = (int) std::min(paths.size() - start, (size_t) NATIVE_BATCH);
+		std::vector<h5meta::Records> batch(n);
+		std::vector<char> scanned(n);
+		#pragma omp parallel for schedule(dynamic)
+		for (int i = 0; i < n; i++) {
+			h5meta::Reader reader;
+			scanned[i] = reader.open(paths[start + i].data()) && reader.scan(batch[i]);
+			if (!scanned[i])
+				printf("Native reader falls back to libhdf5 for %s: %s\n",
+				    paths[start + i].data(), reader.error().data());
+		}
+		for (int i = 0; i < n; i++) {
+			if (scanned[i]) {
+				records.swap(batch[i]);
+			} else {
+				records.clear();
+				scan_file(paths[start + i].data());
+			}
+			register_file(paths[start + i], options);
+		}
+	}
+}
+
+/*
+ **  Diff the records of the native reader against libhdf5 for every file of
+ **  this rank, and print the totals of all ranks on rank 0.
+ **/
+void validate_files(std::vector<std::string> &paths, int rank, int size) {
+	long counts[4] = {0, 0, 0, 0}; /* files, matched, mismatched, unsupported */
+	long totals[4];
+	for (size_t i = rank; i < paths.size(); i += size) {
+		const char *path = paths[i].data();
+		counts[0]++;
+		h5meta::Records native;
+		h5meta::Reader reader;
+		if (!reader.open(path) || !reader.scan(native)) {
+			printf("Validate %s: unsupported by native reader: %s\n", path, reader.error().data());
+			counts[3]++;
+			continue;
+		}
+		records.clear();
+		projectObjects = true;
+		scan_file(path);
+		int diffs = 0;
+		h5meta::Records::iterator a = native.begin();
+		h5meta::Records::iterator b = records.begin();
+		while (a != native.end() || b != records.end()) {
+			if (b == records.end() || (a != native.end() && a->first < b->first)) {
+				printf("Validate %s: only native: %s = %s\n", path, a->first.data(), a->second.data());
+				diffs++;
+				++a;
+			} else if (a == native.end() || b->first < a->first) {
+				printf("Validate %s: only libhdf5: %s = %s\n", path, b->first.data(), b->second.data());
+				diffs++;
+				++b;
+			} else {
+				if (a->second != b->second) {
+					printf("Validate %s: %s differs: native %s, libhdf5 %s\n", path,
+					    a->first.data(), a->second.data(), b->second.data());
+					diffs++;
+				}
+				++a;
+				++b;
+			}
+		}
+		if (diffs == 0)
+			counts[1]++;
+		else
+			counts[2]++;
+		printf("Validate %s: %d records, %d differences\n", path, (int) native.size(), diffs);
+	}
+	records.clear();
+	MPI_Reduce(counts, totals, 4, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+	if (rank == 0)
+		printf("Validated %ld files: %ld match, %ld differ, %ld unsupported by native reader\n",
+		    totals[0], totals[1], totals[2], totals[3]);
+}
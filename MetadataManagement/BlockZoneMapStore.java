@@ -0,0 +1,938 @@
+/*
+ * The Alluxio Open Foundation licenses this work under the Apache License, version 2.0
+ * (the "License"). You may not use this work except in compliance with the License, which is
+ * available at www.apache.org/licenses/LICENSE-2.0
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied, as more fully set forth in the License.
+ *
+ * See the NOTICE file distributed with this work for information regarding copyright ownership.
+ */
+
+package alluxio.master.file;
+
+import alluxio.master.block.BlockId;
+import alluxio.util.io.BufferUtils;
+
+import com.google.common.annotations.VisibleForTesting;
+import com.google.common.base.Charsets;
+import com.google.common.base.Preconditions;
+import com.google.common.cache.Cache;
+import com.google.common.cache.CacheBuilder;
+import com.google.common.cache.RemovalListener;
+import com.google.common.cache.RemovalNotification;
+import org.slf4j.Logger;
+import org.slf4j.LoggerFactory;
+
+import java.io.Closeable;
+import java.io.File;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.nio.ByteBuffer;
+import java.nio.DoubleBuffer;
+import java.nio.LongBuffer;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+import java.util.ArrayList;
+import java.util.HashSet;
+import java.util.Iterator;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.Set;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.zip.CRC32;
+
+import javax.annotation.Nullable;
+import javax.annotation.concurrent.ThreadSafe;
+
+/**
+ * Zone-map store for the per-block variable index. There is one column group per (file, var),
+ * holding the block ids, min values, max values and augmented bitmaps of all blocks of the file
+ * as contiguous arrays ordered by block sequence number, so a range query over all blocks of a
+ * file is a single scan over primitive arrays.
+ *
+ * The column groups of one file live in one segment file {@code <store>/<container id>.seg}:
+ * <pre>
+ *   int magic, int version,
+ *   record*: int record bytes, int capacity, int size, int var bytes, var (UTF-8, padded to 8),
+ *            long[capacity] block ids, double[capacity] mins, double[capacity] maxs,
+ *            long[capacity] bitmaps
+ * </pre>
+ * The last record of a var is its column group, slots past its size have NaN min and max values.
+ * New entries are written in place into the spare capacity of the record and then its size. A
+ * record only moves to the end of the segment when it is full, with twice the capacity, or when
+ * an entry a query may be reading is replaced, so every entry is written a constant number of
+ * times on average.
+ *
+ * Every call to {@link #put} is first appended to the write-ahead log {@code <store>/log}, which
+ * is synced once per call; segments are written without syncing. The first record of a segment
+ * in the log holds its length at the last checkpoint, so replay drops a torn tail of the segment
+ * before applying the log again. A checkpoint compacts the segments written since the last one
+ * once moved records take most of their bytes, syncs the others and truncates the log. It runs
+ * once the log grows large, on {@link #checkpoint()}, and when a store is opened, after the log
+ * has been replayed.
+ *
+ * Column groups are mapped on first access and scanned through buffer views of the mapping. At
+ * most a bounded number of groups stay cached; evicted groups are unmapped once no query holds
+ * them, and mapped again when queried. A mapping only covers entries which are never written in
+ * place again, so cached queries never take a lock.
+ */
+@ThreadSafe
+public final class BlockZoneMapStore implements Closeable {
+  private static final Logger LOG = LoggerFactory.getLogger(BlockZoneMapStore.class);
+
+  private static final int MAGIC = 0x5A4D4150;
+  private static final int VERSION = 2;
+  private static final int SEGMENT_HEADER_BYTES = 2 * 4;
+  /** Bytes of the fixed fields of a record: record bytes, capacity, size and var bytes. */
+  private static final int RECORD_FIELDS_BYTES = 4 * 4;
+  /** Bytes per block: block id, min, max and bitmap. */
+  private static final int ENTRY_BYTES = 4 * 8;
+  /** A file has at most this many blocks, so a column group always fits one mapping. */
+  private static final long MAX_BLOCKS = BlockId.getMaxSequenceNumber() + 1;
+  /** Smallest capacity of a record. */
+  private static final int MIN_CAPACITY = 8;
+  private static final int MAX_VAR_BYTES = 1 << 16;
+  private static final String SEGMENT_SUFFIX = ".seg";
+
+  private static final byte LOG_PUT = 1;
+  private static final byte LOG_REMOVE = 2;
+  /** Bytes of the log after which a put checkpoints the store. */
+  private static final long LOG_CHECKPOINT_BYTES = 64L << 20;
+
+  /** Default number of column groups kept mapped, well below the per-process map limit. */
+  public static final int DEFAULT_MAX_GROUPS = 16384;
+
+  private final File mStoreDir;
+  private final RandomAccessFile mLog;
+  /** Mapped column groups, each holding one reference. Vars without an index are never cached. */
+  private final Cache<GroupKey, ColumnGroup> mGroups;
+  /** Container ids of the segments written since the last checkpoint. */
+  private final Set<Long> mDirtySegments = new HashSet<>();
+
+  /**
+   * Opens a store on the given directory and replays its log.
+   *
+   * @param storeDir the directory holding the segment files
+   * @throws IOException if the log could not be replayed
+   */
+  public BlockZoneMapStore(File storeDir) throws IOException {
+    this(storeDir, DEFAULT_MAX_GROUPS);
+  }
+
+  /**
+   * Opens a store on the given directory and replays its log.
+   *
+   * @param storeDir the directory holding the segment files
+   * @param maxGroups the max number of column groups kept mapped
+   * @throws IOException if the log could not be replayed
+   */
+  public BlockZoneMapStore(File storeDir, int maxGroups) throws IOException {
+    mStoreDir = storeDir;
+    mGroups = CacheBuilder.newBuilder().maximumSize(maxGroups)
+        .removalListener(new RemovalListener<GroupKey, ColumnGroup>() {
+          @Override
+          public void onRemoval(RemovalNotification<GroupKey, ColumnGroup> notification) {
+            notification.getValue().release();
+          }
+        }).build();
+    if (!mStoreDir.exists() && !mStoreDir.mkdirs()) {
+      throw new IOException("Failed to create zone map store directory " + mStoreDir);
+    }
+    mLog = new RandomAccessFile(new File(mStoreDir, "log"), "rw");
+    try {
+      synchronized (this) {
+        replay();
+      }
+    } catch (IOException e) {
+      mLog.close();
+      throw e;
+    }
+  }
+
+  /**
+   * Adds index entries. The whole call is logged and synced once, then every entry is written
+   * into the column group of its file and var. Entries are checked before anything is written,
+   * so an invalid entry rejects the whole call.
+   *
+   * @param blockidlist the ids of the indexed blocks
+   * @param maxlist the max value of the variable in each block
+   * @param minlist the min value of the variable in each block
+   * @param varlist the variable name of each entry
+   * @param auglist the augmented index bitmap of each entry
+   * @throws IOException if the entries could not be persisted
+   */
+  public synchronized void put(List<Long> blockidlist, List<Double> maxlist,
+      List<Double> minlist, List<String> varlist, List<Long> auglist) throws IOException {
+    List<Entry> entries = new ArrayList<>();
+    for (int i = 0; i < maxlist.size(); i++) {
+      long blockId = blockidlist.get(i);
+      long sequenceNumber = BlockId.getSequenceNumber(blockId);
+      Preconditions.checkArgument(sequenceNumber >= 0 && sequenceNumber < MAX_BLOCKS,
+          "Block %s has sequence number %s out of range", blockId, sequenceNumber);
+      Preconditions.checkArgument(varlist.get(i).getBytes(Charsets.UTF_8).length <= MAX_VAR_BYTES,
+          "Var name of block %s is too long", blockId);
+      entries.add(new Entry(blockId, varlist.get(i), minlist.get(i), maxlist.get(i),
+          auglist.get(i)));
+    }
+    if (entries.isEmpty()) {
+      return;
+    }
+    // Segments first written since the last checkpoint, with their length at the checkpoint
+    Map<Long, Long> checkpointed = new LinkedHashMap<>();
+    for (Entry entry : entries) {
+      long containerId = BlockId.getContainerId(entry.mBlockId);
+      if (!mDirtySegments.contains(containerId) && !checkpointed.containsKey(containerId)) {
+        checkpointed.put(containerId, segmentFile(containerId).length());
+      }
+    }
+    ByteBuffer record = ByteBuffer.allocate(1 + 4 + checkpointed.size() * 2 * 8 + 4
+        + entries.size() * (ENTRY_BYTES + 4) + totalVarBytes(entries));
+    record.put(LOG_PUT).putInt(checkpointed.size());
+    for (Map.Entry<Long, Long> segment : checkpointed.entrySet()) {
+      record.putLong(segment.getKey()).putLong(segment.getValue());
+    }
+    record.putInt(entries.size());
+    for (Entry entry : entries) {
+      byte[] var = entry.mVar.getBytes(Charsets.UTF_8);
+      record.putLong(entry.mBlockId).putDouble(entry.mMin).putDouble(entry.mMax)
+          .putLong(entry.mBitmap).putInt(var.length).put(var);
+    }
+    appendLog(record);
+    mDirtySegments.addAll(checkpointed.keySet());
+    apply(entries);
+    if (mLog.length() > LOG_CHECKPOINT_BYTES) {
+      try {
+        checkpoint();
+      } catch (IOException e) {
+        // The entries are in the log already, the next put retries the checkpoint
+        LOG.warn("Failed to checkpoint zone map store {}", mStoreDir, e);
+      }
+    }
+  }
+
+  /**
+   * The returned group must be closed exactly once, which lets it be unmapped after it is evicted.
+   *
+   * @param containerId the block container id of the file
+   * @param var the variable name
+   * @return the column group of the file and var, or null if the file has no index for it
+   * @throws IOException if the segment of the file could not be read or mapped
+   */
+  @Nullable
+  public ColumnGroup get(long containerId, String var) throws IOException {
+    GroupKey key = new GroupKey(containerId, var);
+    ColumnGroup group = mGroups.getIfPresent(key);
+    if (group != null && group.retain()) {
+      return group;
+    }
+    // Mapping under the lock of put keeps a group written meanwhile from being cached stale
+    synchronized (this) {
+      group = mGroups.getIfPresent(key);
+      if (group != null && group.retain()) {
+        return group;
+      }
+      group = load(containerId, var);
+      if (group == null) {
+        return null;
+      }
+      group.retain();
+      mGroups.put(key, group);
+      return group;
+    }
+  }
+
+  /**
+   * Removes the index of all blocks of a file.
+   *
+   * @param containerId the block container id of the file
+   */
+  public synchronized void remove(long containerId) {
+    File segment = segmentFile(containerId);
+    if (!segment.exists()) {
+      return;
+    }
+    try {
+      appendLog(ByteBuffer.allocate(1 + 8).put(LOG_REMOVE).putLong(containerId));
+    } catch (IOException e) {
+      // Container ids are not reused, so a segment restored by the log is only dead space
+      LOG.warn("Failed to log the removal of zone map segment {}", segment, e);
+    }
+    removeSegment(containerId);
+  }
+
+  /**
+   * Syncs the segments written since the last checkpoint, compacting those mostly made of moved
+   * records, and truncates the log.
+   *
+   * @throws IOException if a segment or the log could not be synced
+   */
+  public synchronized void checkpoint() throws IOException {
+    for (long containerId : mDirtySegments) {
+      File segment = segmentFile(containerId);
+      if (!segment.exists()) {
+        continue;
+      }
+      Map<String, Record> records;
+      try (RandomAccessFile raf = new RandomAccessFile(segment, "rw")) {
+        FileChannel channel = raf.getChannel();
+        records = readRecords(channel, segment);
+        long liveBytes = SEGMENT_HEADER_BYTES;
+        for (Record record : records.values()) {
+          liveBytes += record.mBytes;
+        }
+        if (channel.size() <= 2 * liveBytes) {
+          channel.force(true);
+          continue;
+        }
+      }
+      // Mapped groups keep reading the records of the replaced file
+      compact(segment, records);
+    }
+    mDirtySegments.clear();
+    mLog.getChannel().truncate(0);
+    mLog.getChannel().force(true);
+  }
+
+  /**
+   * Checkpoints the store, closes its log and unmaps the cached groups once they are released.
+   *
+   * @throws IOException if the store could not be checkpointed
+   */
+  @Override
+  public synchronized void close() throws IOException {
+    try {
+      checkpoint();
+    } finally {
+      mGroups.invalidateAll();
+      mLog.close();
+    }
+  }
+
+  /**
+   * @return the number of column groups currently mapped
+   */
+  @VisibleForTesting
+  long getMappedGroups() {
+    return mGroups.size();
+  }
+
+  /**
+   * @param containerId the block container id of a file
+   * @return the segment file holding the column groups of the file
+   */
+  @VisibleForTesting
+  File segmentFile(long containerId) {
+    return new File(mStoreDir, containerId + SEGMENT_SUFFIX);
+  }
+
+  private void appendLog(ByteBuffer body) throws IOException {
+    body.flip();
+    CRC32 crc = new CRC32();
+    crc.update(body.array(), 0, body.limit());
+    ByteBuffer record = ByteBuffer.allocate(8 + body.limit());
+    record.putInt(body.limit()).putInt((int) crc.getValue()).put(body);
+    record.flip();
+    FileChannel channel = mLog.getChannel();
+    writeFully(channel, record, channel.size());
+    channel.force(false);
+  }
+
+  /**
+   * Applies the complete records of the log, drops a torn one at its end and checkpoints.
+   */
+  private void replay() throws IOException {
+    FileChannel channel = mLog.getChannel();
+    long length = channel.size();
+    long position = 0;
+    int records = 0;
+    ByteBuffer fields = ByteBuffer.allocate(8);
+    while (position + 8 <= length) {
+      fields.clear();
+      readFully(channel, fields, position);
+      int bodyBytes = fields.getInt();
+      int checksum = fields.getInt();
+      if (bodyBytes <= 0 || position + 8 + bodyBytes > length) {
+        break;
+      }
+      ByteBuffer body = ByteBuffer.allocate(bodyBytes);
+      readFully(channel, body, position + 8);
+      CRC32 crc = new CRC32();
+      crc.update(body.array(), 0, bodyBytes);
+      if ((int) crc.getValue() != checksum) {
+        break;
+      }
+      if (body.get() == LOG_REMOVE) {
+        removeSegment(body.getLong());
+      } else {
+        int segments = body.getInt();
+        for (int i = 0; i < segments; i++) {
+          truncateSegment(body.getLong(), body.getLong());
+        }
+        int count = body.getInt();
+        List<Entry> entries = new ArrayList<>(count);
+        for (int i = 0; i < count; i++) {
+          long blockId = body.getLong();
+          double min = body.getDouble();
+          double max = body.getDouble();
+          long bitmap = body.getLong();
+          byte[] var = new byte[body.getInt()];
+          body.get(var);
+          entries.add(new Entry(blockId, new String(var, Charsets.UTF_8), min, max, bitmap));
+        }
+        apply(entries);
+      }
+      position += 8 + bodyBytes;
+      records++;
+    }
+    if (position < length) {
+      LOG.warn("Dropping {} bytes of a torn record at the end of zone map log in {}",
+          length - position, mStoreDir);
+    }
+    if (records > 0) {
+      LOG.info("Replayed {} zone map log records in {}", records, mStoreDir);
+    }
+    checkpoint();
+  }
+
+  /**
+   * Drops what was written to a segment after the checkpoint it had the given length at.
+   */
+  private void truncateSegment(long containerId, long length) throws IOException {
+    mDirtySegments.add(containerId);
+    File segment = segmentFile(containerId);
+    if (segment.length() > length) {
+      LOG.info("Truncating zone map segment {} from {} to {} bytes to replay the log", segment,
+          segment.length(), length);
+      try (RandomAccessFile raf = new RandomAccessFile(segment, "rw")) {
+        raf.getChannel().truncate(length);
+      }
+    }
+  }
+
+  /**
+   * Writes entries into the segments of their files, without syncing.
+   */
+  private void apply(List<Entry> entries) throws IOException {
+    Map<Long, Map<String, List<Entry>>> segments = new LinkedHashMap<>();
+    for (Entry entry : entries) {
+      long containerId = BlockId.getContainerId(entry.mBlockId);
+      Map<String, List<Entry>> groups = segments.get(containerId);
+      if (groups == null) {
+        groups = new LinkedHashMap<>();
+        segments.put(containerId, groups);
+      }
+      List<Entry> group = groups.get(entry.mVar);
+      if (group == null) {
+        group = new ArrayList<>();
+        groups.put(entry.mVar, group);
+      }
+      group.add(entry);
+    }
+    for (Map.Entry<Long, Map<String, List<Entry>>> segment : segments.entrySet()) {
+      long containerId = segment.getKey();
+      File file = segmentFile(containerId);
+      try (RandomAccessFile raf = new RandomAccessFile(file, "rw")) {
+        FileChannel channel = raf.getChannel();
+        if (channel.size() == 0) {
+          writeFully(channel, segmentHeader(), 0);
+        }
+        Map<String, Record> records = readRecords(channel, file);
+        for (Map.Entry<String, List<Entry>> group : segment.getValue().entrySet()) {
+          applyGroup(channel, records.get(group.getKey()), group.getKey(), group.getValue());
+          mGroups.invalidate(new GroupKey(containerId, group.getKey()));
+        }
+      }
+    }
+  }
+
+  /**
+   * Writes the entries of one column group, in place when no query can be reading the slots.
+   */
+  private static void applyGroup(FileChannel channel, @Nullable Record record, String var,
+      List<Entry> entries) throws IOException {
+    int size = record == null ? 0 : record.mSize;
+    int newSize = size;
+    for (Entry entry : entries) {
+      newSize = Math.max(newSize, entry.getIndex() + 1);
+    }
+    boolean inPlace = record != null && newSize <= record.mCapacity;
+    List<Entry> changed = new ArrayList<>();
+    ByteBuffer slot = ByteBuffer.allocate(8);
+    for (Entry entry : entries) {
+      if (record != null && entry.getIndex() < size) {
+        slot.clear();
+        readFully(channel, slot, record.slotOffset(1, entry.getIndex()));
+        double min = slot.getDouble();
+        // A slot without entry is past the prefix every query scans, so it is written in place
+        if (!Double.isNaN(min)) {
+          if (entry.equals(readEntry(channel, record, entry.getIndex(), var))) {
+            continue;
+          }
+          inPlace = false;
+        }
+      }
+      changed.add(entry);
+    }
+    if (changed.isEmpty()) {
+      return;
+    }
+    if (inPlace) {
+      for (Entry entry : changed) {
+        int index = entry.getIndex();
+        writeLong(channel, entry.mBlockId, record.slotOffset(0, index));
+        writeLong(channel, Double.doubleToRawLongBits(entry.mMax), record.slotOffset(2, index));
+        writeLong(channel, entry.mBitmap, record.slotOffset(3, index));
+        // The min value publishes the entry, as a query stops at the first NaN min
+        writeLong(channel, Double.doubleToRawLongBits(entry.mMin), record.slotOffset(1, index));
+      }
+      if (newSize > size) {
+        ByteBuffer value = ByteBuffer.allocate(4).putInt(newSize);
+        value.flip();
+        writeFully(channel, value, record.mOffset + 8);
+      }
+      return;
+    }
+    relocate(channel, record, var, newSize, changed);
+  }
+
+  /**
+   * Appends a new record of a column group to the end of the segment, leaving the old one to the
+   * queries still reading it.
+   */
+  private static void relocate(FileChannel channel, @Nullable Record record, String var,
+      int newSize, List<Entry> entries) throws IOException {
+    int capacity = record == null ? MIN_CAPACITY : record.mCapacity;
+    if (newSize > capacity) {
+      capacity = (int) Math.min(MAX_BLOCKS, Math.max(newSize, 2L * capacity));
+    }
+    byte[] varBytes = var.getBytes(Charsets.UTF_8);
+    Record moved = new Record(channel.size(), capacity, newSize, varBytes.length);
+    ByteBuffer buffer = ByteBuffer.allocate(moved.mBytes);
+    buffer.putInt(moved.mBytes).putInt(capacity).putInt(newSize).putInt(varBytes.length)
+        .put(varBytes);
+    int oldSize = record == null ? 0 : record.mSize;
+    for (int column = 0; column < 4; column++) {
+      int start = (int) (moved.slotOffset(column, 0) - moved.mOffset);
+      if (record != null) {
+        ByteBuffer old = ByteBuffer.allocate(8 * oldSize);
+        readFully(channel, old, record.slotOffset(column, 0));
+        buffer.position(start);
+        buffer.put(old);
+      }
+      if (column == 1 || column == 2) {
+        for (int i = oldSize; i < capacity; i++) {
+          buffer.putDouble(start + 8 * i, Double.NaN);
+        }
+      }
+    }
+    for (Entry entry : entries) {
+      int index = entry.getIndex();
+      buffer.putLong((int) (moved.slotOffset(0, index) - moved.mOffset), entry.mBlockId);
+      buffer.putDouble((int) (moved.slotOffset(1, index) - moved.mOffset), entry.mMin);
+      buffer.putDouble((int) (moved.slotOffset(2, index) - moved.mOffset), entry.mMax);
+      buffer.putLong((int) (moved.slotOffset(3, index) - moved.mOffset), entry.mBitmap);
+    }
+    buffer.clear();
+    writeFully(channel, buffer, moved.mOffset);
+  }
+
+  private static Entry readEntry(FileChannel channel, Record record, int index, String var)
+      throws IOException {
+    ByteBuffer value = ByteBuffer.allocate(8);
+    long[] slots = new long[4];
+    for (int column = 0; column < 4; column++) {
+      value.clear();
+      readFully(channel, value, record.slotOffset(column, index));
+      slots[column] = value.getLong();
+    }
+    return new Entry(slots[0], var, Double.longBitsToDouble(slots[1]),
+        Double.longBitsToDouble(slots[2]), slots[3]);
+  }
+
+  /**
+   * Rewrites a segment with only the last record of every var.
+   */
+  private static void compact(File file, Map<String, Record> records) throws IOException {
+    File tmp = new File(file.getPath() + ".tmp");
+    try (RandomAccessFile in = new RandomAccessFile(file, "r");
+         RandomAccessFile out = new RandomAccessFile(tmp, "rw")) {
+      out.setLength(0);
+      FileChannel output = out.getChannel();
+      writeFully(output, segmentHeader(), 0);
+      long position = SEGMENT_HEADER_BYTES;
+      for (Record record : records.values()) {
+        ByteBuffer bytes = ByteBuffer.allocate(record.mBytes);
+        readFully(in.getChannel(), bytes, record.mOffset);
+        bytes.rewind();
+        writeFully(output, bytes, position);
+        position += record.mBytes;
+      }
+      // Sync before the rename, the log is truncated once the checkpoint completes
+      output.force(true);
+    }
+    if (!tmp.renameTo(file)) {
+      if (!file.delete() || !tmp.renameTo(file)) {
+        throw new IOException("Failed to replace zone map segment " + file);
+      }
+    }
+  }
+
+  private void removeSegment(long containerId) {
+    Iterator<GroupKey> keys = mGroups.asMap().keySet().iterator();
+    while (keys.hasNext()) {
+      if (keys.next().mContainerId == containerId) {
+        keys.remove();
+      }
+    }
+    mDirtySegments.remove(containerId);
+    File segment = segmentFile(containerId);
+    if (segment.exists() && !segment.delete()) {
+      LOG.warn("Failed to delete zone map segment {}", segment);
+    }
+  }
+
+  /**
+   * Maps the column group of a file and var, holding one reference for the caller.
+   */
+  @Nullable
+  private ColumnGroup load(long containerId, String var) throws IOException {
+    File file = segmentFile(containerId);
+    if (!file.exists()) {
+      return null;
+    }
+    try (RandomAccessFile raf = new RandomAccessFile(file, "r")) {
+      FileChannel channel = raf.getChannel();
+      Record record = readRecords(channel, file).get(var);
+      if (record == null) {
+        return null;
+      }
+      // The mapping stays valid after the channel is closed
+      MappedByteBuffer mapping =
+          channel.map(FileChannel.MapMode.READ_ONLY, record.mOffset, record.mBytes);
+      return new ColumnGroup(mapping, record.mSize,
+          section(mapping, record, 0).asLongBuffer(),
+          section(mapping, record, 1).asDoubleBuffer(),
+          section(mapping, record, 2).asDoubleBuffer(),
+          section(mapping, record, 3).asLongBuffer());
+    }
+  }
+
+  private static ByteBuffer section(ByteBuffer mapping, Record record, int column) {
+    ByteBuffer section = mapping.duplicate();
+    int start = (int) (record.slotOffset(column, 0) - record.mOffset);
+    section.position(start);
+    section.limit(start + 8 * record.mSize);
+    return section.slice();
+  }
+
+  /**
+   * @return the records of a segment, the last one of every var
+   */
+  private static Map<String, Record> readRecords(FileChannel channel, File file)
+      throws IOException {
+    long length = channel.size();
+    ByteBuffer header = ByteBuffer.allocate(SEGMENT_HEADER_BYTES);
+    if (length < SEGMENT_HEADER_BYTES) {
+      throw new IOException("Truncated zone map segment " + file + " of " + length + " bytes");
+    }
+    readFully(channel, header, 0);
+    if (header.getInt() != MAGIC || header.getInt() != VERSION) {
+      throw new IOException("Unsupported zone map format in " + file);
+    }
+    Map<String, Record> records = new LinkedHashMap<>();
+    ByteBuffer fields = ByteBuffer.allocate(RECORD_FIELDS_BYTES);
+    long offset = SEGMENT_HEADER_BYTES;
+    while (offset < length) {
+      if (offset + RECORD_FIELDS_BYTES > length) {
+        throw new IOException("Truncated zone map segment " + file + " at " + offset);
+      }
+      fields.clear();
+      readFully(channel, fields, offset);
+      int bytes = fields.getInt();
+      int capacity = fields.getInt();
+      int size = fields.getInt();
+      int varBytes = fields.getInt();
+      if (capacity < 0 || capacity > MAX_BLOCKS || size < 0 || size > capacity || varBytes < 0
+          || varBytes > MAX_VAR_BYTES || bytes != Record.bytes(capacity, varBytes)
+          || offset + bytes > length) {
+        throw new IOException("Zone map segment " + file + " of " + length + " bytes has a "
+            + "corrupt record at " + offset);
+      }
+      ByteBuffer var = ByteBuffer.allocate(varBytes);
+      readFully(channel, var, offset + RECORD_FIELDS_BYTES);
+      records.put(new String(var.array(), Charsets.UTF_8),
+          new Record(offset, capacity, size, varBytes));
+      offset += bytes;
+    }
+    return records;
+  }
+
+  private static ByteBuffer segmentHeader() {
+    ByteBuffer header = ByteBuffer.allocate(SEGMENT_HEADER_BYTES).putInt(MAGIC).putInt(VERSION);
+    header.flip();
+    return header;
+  }
+
+  private static int totalVarBytes(List<Entry> entries) {
+    int bytes = 0;
+    for (Entry entry : entries) {
+      bytes += entry.mVar.getBytes(Charsets.UTF_8).length;
+    }
+    return bytes;
+  }
+
+  /**
+   * Reads until the buffer is full and rewinds it.
+   */
+  private static void readFully(FileChannel channel, ByteBuffer buffer, long position)
+      throws IOException {
+    int start = buffer.position();
+    while (buffer.hasRemaining()) {
+      if (channel.read(buffer, position + buffer.position() - start) < 0) {
+        throw new IOException("Unexpected end of zone map file at " + position);
+      }
+    }
+    buffer.flip();
+  }
+
+  private static void writeLong(FileChannel channel, long value, long position)
+      throws IOException {
+    ByteBuffer buffer = ByteBuffer.allocate(8).putLong(value);
+    buffer.flip();
+    writeFully(channel, buffer, position);
+  }
+
+  private static void writeFully(FileChannel channel, ByteBuffer buffer, long position)
+      throws IOException {
+    long offset = position;
+    while (buffer.hasRemaining()) {
+      offset += channel.write(buffer, offset);
+    }
+  }
+
+  /** One index entry of a block. */
+  private static final class Entry {
+    private final long mBlockId;
+    private final String mVar;
+    private final double mMin;
+    private final double mMax;
+    private final long mBitmap;
+
+    private Entry(long blockId, String var, double min, double max, long bitmap) {
+      mBlockId = blockId;
+      mVar = var;
+      mMin = min;
+      mMax = max;
+      mBitmap = bitmap;
+    }
+
+    private int getIndex() {
+      return (int) BlockId.getSequenceNumber(mBlockId);
+    }
+
+    @Override
+    public boolean equals(Object o) {
+      if (this == o) {
+        return true;
+      }
+      if (!(o instanceof Entry)) {
+        return false;
+      }
+      Entry that = (Entry) o;
+      return mBlockId == that.mBlockId && mVar.equals(that.mVar)
+          && Double.doubleToLongBits(mMin) == Double.doubleToLongBits(that.mMin)
+          && Double.doubleToLongBits(mMax) == Double.doubleToLongBits(that.mMax)
+          && mBitmap == that.mBitmap;
+    }
+
+    @Override
+    public int hashCode() {
+      return (int) (mBlockId ^ (mBlockId >>> 32)) * 31 + mVar.hashCode();
+    }
+  }
+
+  /** Location and size of the record of one column group in its segment. */
+  private static final class Record {
+    private final long mOffset;
+    private final int mCapacity;
+    private final int mSize;
+    private final int mVarBytes;
+    private final int mBytes;
+
+    private Record(long offset, int capacity, int size, int varBytes) {
+      mOffset = offset;
+      mCapacity = capacity;
+      mSize = size;
+      mVarBytes = varBytes;
+      mBytes = bytes(capacity, varBytes);
+    }
+
+    private static int bytes(int capacity, int varBytes) {
+      return headerBytes(varBytes) + ENTRY_BYTES * capacity;
+    }
+
+    private static int headerBytes(int varBytes) {
+      return RECORD_FIELDS_BYTES + (varBytes + 7) / 8 * 8;
+    }
+
+    /**
+     * @return the file offset of a slot of a column: block ids, mins, maxs or bitmaps
+     */
+    private long slotOffset(int column, int index) {
+      return mOffset + headerBytes(mVarBytes) + 8L * column * mCapacity + 8L * index;
+    }
+  }
+
+  /** Identifies the column group of one var of one file. */
+  private static final class GroupKey {
+    private final long mContainerId;
+    private final String mVar;
+
+    private GroupKey(long containerId, String var) {
+      mContainerId = containerId;
+      mVar = var;
+    }
+
+    @Override
+    public boolean equals(Object o) {
+      if (this == o) {
+        return true;
+      }
+      if (!(o instanceof GroupKey)) {
+        return false;
+      }
+      GroupKey that = (GroupKey) o;
+      return mContainerId == that.mContainerId && mVar.equals(that.mVar);
+    }
+
+    @Override
+    public int hashCode() {
+      return 31 * (int) (mContainerId ^ (mContainerId >>> 32)) + mVar.hashCode();
+    }
+  }
+
+  /**
+   * Index of one variable over all blocks of one file, ordered by block sequence number, read
+   * through views of the mapped segment. Blocks without an entry have NaN min and max values.
+   * The mapping is released when the group is closed by its last holder, the store included.
+   */
+  @ThreadSafe
+  public static final class ColumnGroup implements Closeable {
+    private final MappedByteBuffer mMapping;
+    /** Holders of the group; the mapping is released when this drops to 0. */
+    private final AtomicInteger mReferences = new AtomicInteger(1);
+    private final int mSize;
+    // Only absolute gets are used, so the views are shared by all readers
+    private final LongBuffer mBlockIds;
+    private final DoubleBuffer mMins;
+    private final DoubleBuffer mMaxs;
+    private final LongBuffer mBitmaps;
+    /** Number of leading blocks which all have an entry. */
+    private final int mPrefixLength;
+
+    private ColumnGroup(MappedByteBuffer mapping, int size, LongBuffer blockIds,
+        DoubleBuffer mins, DoubleBuffer maxs, LongBuffer bitmaps) {
+      mMapping = mapping;
+      mSize = size;
+      mBlockIds = blockIds;
+      mMins = mins;
+      mMaxs = maxs;
+      mBitmaps = bitmaps;
+      int prefix = 0;
+      while (prefix < mSize && !Double.isNaN(mMins.get(prefix))) {
+        prefix++;
+      }
+      mPrefixLength = prefix;
+    }
+
+    /**
+     * Only the leading blocks which all have an entry are considered, as a query stops at the
+     * first block without index information.
+     *
+     * @return the number of leading blocks with an entry
+     */
+    public int getPrefixLength() {
+      return mPrefixLength;
+    }
+
+    /**
+     * @param index the sequence number of the block in the file
+     * @return the id of the block at the index
+     */
+    public long getBlockId(int index) {
+      return mBlockIds.get(index);
+    }
+
+    /**
+     * Finds the blocks whose value range overlaps [min, max]. With the augmented index, the
+     * bitmap of a block must also overlap the query range, where the 64 bits of every bitmap
+     * split the value range of the first block.
+     *
+     * @param min the min value to query
+     * @param max the max value to query
+     * @param augmented whether to use augmented index
+     * @param hits receives the sequence numbers of the satisfied blocks, sized at least
+     *        {@link #getPrefixLength()}
+     * @return the number of satisfied blocks written to hits
+     */
+    public int scan(double min, double max, boolean augmented, int[] hits) {
+      int n = mPrefixLength;
+      int count = 0;
+      if (!augmented) {
+        for (int i = 0; i < n; i++) {
+          hits[count] = i;
+          count += (mMaxs.get(i) >= min & mMins.get(i) <= max) ? 1 : 0;
+        }
+        return count;
+      }
+      long mask = n == 0 ? 0 : queryMask(mMins.get(0), mMaxs.get(0), min, max);
+      for (int i = 0; i < n; i++) {
+        hits[count] = i;
+        count += (mMaxs.get(i) >= min & mMins.get(i) <= max & (mBitmaps.get(i) & mask) != 0)
+            ? 1 : 0;
+      }
+      return count;
+    }
+
+    /**
+     * Releases the reference of the caller of {@link BlockZoneMapStore#get}.
+     */
+    @Override
+    public void close() {
+      release();
+    }
+
+    private boolean retain() {
+      while (true) {
+        int references = mReferences.get();
+        if (references == 0) {
+          return false;
+        }
+        if (mReferences.compareAndSet(references, references + 1)) {
+          return true;
+        }
+      }
+    }
+
+    private void release() {
+      if (mReferences.decrementAndGet() == 0) {
+        BufferUtils.cleanDirectBuffer(mMapping);
+      }
+    }
+
+    private static long queryMask(double firstmin, double firstmax, double min, double max) {
+      double range = ((firstmax - firstmin) == 0) ? 1 : ((firstmax - firstmin) / 64);
+      int t1 = ((min - firstmin) < 0) ? 63 : (63 - (int) ((min - firstmin) / range));
+      int t2 = ((max - firstmin) < 0) ? 63 : (63 - (int) ((max - firstmin) / range));
+      t1 = Math.max(t1, 0);
+      t2 = Math.max(t2, 0);
+      long mask = 0L;
+      for (int i = t2; i <= t1; i++) {
+        mask |= (1L << i);
+      }
+      return mask;
+    }
+  }
+}
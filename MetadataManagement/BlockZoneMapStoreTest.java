@@ -0,0 +1,221 @@
+/*
+ * The Alluxio Open Foundation licenses this work under the Apache License, version 2.0
+ * (the "License"). You may not use this work except in compliance with the License, which is
+ * available at www.apache.org/licenses/LICENSE-2.0
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied, as more fully set forth in the License.
+ *
+ * See the NOTICE file distributed with this work for information regarding copyright ownership.
+ */
+
+package alluxio.master.file;
+
+import alluxio.master.block.BlockId;
+
+import org.junit.Assert;
+import org.junit.Rule;
+import org.junit.Test;
+import org.junit.rules.TemporaryFolder;
+
+import java.io.File;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.util.ArrayList;
+import java.util.List;
+
+/**
+ * Unit tests for {@link BlockZoneMapStore}.
+ */
+public final class BlockZoneMapStoreTest {
+  @Rule
+  public TemporaryFolder mFolder = new TemporaryFolder();
+
+  /** Index entries of one call to {@link BlockZoneMapStore#put}. */
+  private static final class Entries {
+    private final List<Long> mBlockIds = new ArrayList<>();
+    private final List<Double> mMaxs = new ArrayList<>();
+    private final List<Double> mMins = new ArrayList<>();
+    private final List<String> mVars = new ArrayList<>();
+    private final List<Long> mBitmaps = new ArrayList<>();
+
+    private Entries add(long containerId, long sequenceNumber, String var, double min,
+        double max) {
+      mBlockIds.add(BlockId.createBlockId(containerId, sequenceNumber));
+      mMins.add(min);
+      mMaxs.add(max);
+      mVars.add(var);
+      mBitmaps.add(-1L);
+      return this;
+    }
+
+    private void putTo(BlockZoneMapStore store) throws Exception {
+      store.put(mBlockIds, mMaxs, mMins, mVars, mBitmaps);
+    }
+  }
+
+  private static int scan(BlockZoneMapStore.ColumnGroup group, double min, double max) {
+    int[] hits = new int[group.getPrefixLength()];
+    return group.scan(min, max, false, hits);
+  }
+
+  /**
+   * Tests that a batch builds one group per var and that scans select the overlapping blocks.
+   */
+  @Test
+  public void putAndScan() throws Exception {
+    BlockZoneMapStore store = new BlockZoneMapStore(mFolder.newFolder());
+    Entries entries = new Entries();
+    for (int i = 0; i < 1000; i++) {
+      entries.add(7, i, "temp", i, i + 1).add(7, i, "rain", -i, 0);
+    }
+    entries.putTo(store);
+
+    BlockZoneMapStore.ColumnGroup temp = store.get(7, "temp");
+    Assert.assertEquals(1000, temp.getPrefixLength());
+    Assert.assertEquals(BlockId.createBlockId(7, 999), temp.getBlockId(999));
+    Assert.assertEquals(3, scan(temp, 10.5, 12.5));
+    Assert.assertEquals(1000, scan(store.get(7, "rain"), -1, 0));
+    Assert.assertNull(store.get(7, "wind"));
+    Assert.assertNull(store.get(8, "temp"));
+  }
+
+  /**
+   * Tests that later entries extend a group, and a gap ends the prefix of indexed blocks.
+   */
+  @Test
+  public void extend() throws Exception {
+    BlockZoneMapStore store = new BlockZoneMapStore(mFolder.newFolder());
+    new Entries().add(3, 0, "temp", 0, 1).add(3, 1, "temp", 1, 2).putTo(store);
+    new Entries().add(3, 3, "temp", 3, 4).putTo(store);
+    Assert.assertEquals(2, store.get(3, "temp").getPrefixLength());
+    new Entries().add(3, 2, "temp", 2, 3).putTo(store);
+    Assert.assertEquals(4, store.get(3, "temp").getPrefixLength());
+    Assert.assertEquals(1, scan(store.get(3, "temp"), 3.5, 3.5));
+  }
+
+  /**
+   * Tests that groups dropped from the bounded cache, or written by an earlier store, are mapped
+   * again from their files.
+   */
+  @Test
+  public void reload() throws Exception {
+    File dir = mFolder.newFolder();
+    BlockZoneMapStore store = new BlockZoneMapStore(dir, 2);
+    Entries entries = new Entries();
+    for (int c = 1; c <= 10; c++) {
+      entries.add(c, 0, "temp", c, c);
+    }
+    entries.putTo(store);
+    Assert.assertTrue(store.getMappedGroups() <= 2);
+    for (int c = 1; c <= 10; c++) {
+      try (BlockZoneMapStore.ColumnGroup group = store.get(c, "temp")) {
+        Assert.assertEquals(1, scan(group, c, c));
+      }
+    }
+    store.close();
+
+    BlockZoneMapStore reopened = new BlockZoneMapStore(dir);
+    Assert.assertEquals(1, scan(reopened.get(5, "temp"), 5, 5));
+  }
+
+  /**
+   * Tests that a group still held by a query stays readable after it is evicted from the cache.
+   */
+  @Test
+  public void evictHeld() throws Exception {
+    BlockZoneMapStore store = new BlockZoneMapStore(mFolder.newFolder(), 1);
+    new Entries().add(1, 0, "temp", 0, 1).add(2, 0, "temp", 5, 6).putTo(store);
+    try (BlockZoneMapStore.ColumnGroup first = store.get(1, "temp")) {
+      try (BlockZoneMapStore.ColumnGroup second = store.get(2, "temp")) {
+        Assert.assertEquals(1, scan(second, 5, 6));
+      }
+      Assert.assertEquals(1, store.getMappedGroups());
+      Assert.assertEquals(1, scan(first, 0, 1));
+    }
+    try (BlockZoneMapStore.ColumnGroup first = store.get(1, "temp")) {
+      Assert.assertEquals(1, scan(first, 0, 1));
+    }
+  }
+
+  /**
+   * Tests that single entry puts append into the spare capacity of a group, and that a
+   * checkpoint compacts the records moved by replaced entries.
+   */
+  @Test
+  public void append() throws Exception {
+    File dir = mFolder.newFolder();
+    BlockZoneMapStore store = new BlockZoneMapStore(dir);
+    for (int i = 0; i < 1000; i++) {
+      new Entries().add(2, i, "temp", i, i + 1).putTo(store);
+    }
+    // Doubling capacities move at most as many entries as the group holds
+    Assert.assertTrue(store.segmentFile(2).length() < 3 * 1024 * 32);
+    new Entries().add(2, 0, "temp", -1, 0).putTo(store);
+    new Entries().add(2, 0, "temp", -2, 0).putTo(store);
+    store.checkpoint();
+    Assert.assertTrue(store.segmentFile(2).length() < 1100 * 32);
+    store.close();
+
+    try (BlockZoneMapStore.ColumnGroup group = new BlockZoneMapStore(dir).get(2, "temp")) {
+      Assert.assertEquals(1000, group.getPrefixLength());
+      Assert.assertEquals(2, scan(group, 499.5, 500.5));
+      Assert.assertEquals(1, scan(group, -2, -1.5));
+    }
+  }
+
+  /**
+   * Tests that entries whose segment writes were lost are restored from the log, and that a
+   * replayed removal stays removed.
+   */
+  @Test
+  public void replay() throws Exception {
+    File dir = mFolder.newFolder();
+    BlockZoneMapStore store = new BlockZoneMapStore(dir);
+    new Entries().add(5, 0, "temp", 0, 1).add(6, 0, "temp", 0, 1).putTo(store);
+    new Entries().add(5, 1, "temp", 1, 2).putTo(store);
+    store.remove(6);
+    // The segments are only synced by a checkpoint, lose them without closing the store
+    Assert.assertTrue(store.segmentFile(5).delete());
+
+    BlockZoneMapStore reopened = new BlockZoneMapStore(dir);
+    try (BlockZoneMapStore.ColumnGroup group = reopened.get(5, "temp")) {
+      Assert.assertEquals(2, group.getPrefixLength());
+    }
+    Assert.assertNull(reopened.get(6, "temp"));
+  }
+
+  /**
+   * Tests that a truncated segment is reported instead of read past its end.
+   */
+  @Test
+  public void truncated() throws Exception {
+    File dir = mFolder.newFolder();
+    BlockZoneMapStore store = new BlockZoneMapStore(dir);
+    new Entries().add(4, 0, "temp", 0, 1).add(4, 1, "temp", 1, 2).putTo(store);
+    store.close();
+    try (RandomAccessFile raf = new RandomAccessFile(store.segmentFile(4), "rw")) {
+      raf.setLength(raf.length() - 8);
+    }
+    try {
+      new BlockZoneMapStore(dir).get(4, "temp");
+      Assert.fail("A truncated segment should not be read");
+    } catch (IOException e) {
+      // expected
+    }
+  }
+
+  /**
+   * Tests that removing a file drops its groups from the cache and the disk.
+   */
+  @Test
+  public void remove() throws Exception {
+    File dir = mFolder.newFolder();
+    BlockZoneMapStore store = new BlockZoneMapStore(dir);
+    new Entries().add(9, 0, "temp", 0, 1).add(9, 0, "rain", 0, 1).putTo(store);
+    store.remove(9);
+    Assert.assertNull(store.get(9, "temp"));
+    Assert.assertNull(store.get(9, "rain"));
+    Assert.assertFalse(store.segmentFile(9).exists());
+  }
+}
@@ -45,6 +45,7 @@ import alluxio.master.block.BlockId;
 import alluxio.master.block.BlockMaster;
 import alluxio.master.file.async.AsyncPersistHandler;
 import alluxio.master.file.meta.FileSystemMasterView;
+import alluxio.master.file.meta.HDF5Projection;
 import alluxio.master.file.meta.Inode;
 import alluxio.master.file.meta.InodeDirectory;
 import alluxio.master.file.meta.InodeDirectoryIdGenerator;
@@ -58,6 +59,8 @@ import alluxio.master.file.meta.PersistenceState;
 import alluxio.master.file.meta.TempInodePathForChild;
 import alluxio.master.file.meta.TempInodePathForDescendant;
 import alluxio.master.file.meta.TtlBucketList;
+import alluxio.master.file.meta.UDMImage;
+import alluxio.master.file.meta.UDMSummary;
 import alluxio.master.file.meta.UfsAbsentPathCache;
 import alluxio.master.file.meta.options.MountInfo;
 import alluxio.master.file.options.CheckConsistencyOptions;
@@ -76,6 +79,7 @@ import alluxio.master.journal.JournalContext;
 import alluxio.master.journal.JournalSystem;
 import alluxio.master.journal.NoopJournalContext;
 import alluxio.master.journal.ufs.JavaSerializer;
+import alluxio.master.journal.ufs.UfsJournal;
 import alluxio.metrics.MetricsSystem;
 import alluxio.proto.journal.File.AddMountPointEntry;
 import alluxio.proto.journal.File.AsyncPersistRequestEntry;
@@ -124,10 +128,10 @@ import alluxio.wire.LoadMetadataType;
 import alluxio.wire.MountPointInfo;
 import alluxio.wire.TtlAction;
 import alluxio.wire.WorkerInfo;
-import alluxio.wire.IndexInfo;
 
 import com.codahale.metrics.Counter;
 import com.codahale.metrics.Gauge;
+import com.google.common.annotations.VisibleForTesting;
 import com.google.common.base.Preconditions;
 import com.google.common.base.Throwables;
 import com.google.common.collect.ImmutableSet;
@@ -155,6 +159,7 @@ import java.util.Stack;
 import java.util.TreeMap;
 import java.util.concurrent.BlockingQueue;
 import java.util.concurrent.Callable;
+import java.util.concurrent.ConcurrentHashMap;
 import java.util.concurrent.ExecutorService;
 import java.util.concurrent.Future;
 import java.util.concurrent.LinkedBlockingQueue;
@@ -166,7 +171,8 @@ import javax.annotation.concurrent.NotThreadSafe;
  * The master that handles all file system metadata management.
  */
 @NotThreadSafe // TODO(jiri): make thread-safe (c.f. ALLUXIO-1664)
-public final class DefaultFileSystemMaster extends AbstractMaster implements FileSystemMaster {
+public final class DefaultFileSystemMaster extends AbstractMaster
+    implements FileSystemMaster, UfsJournal.CheckpointImage {
   private static final Logger LOG = LoggerFactory.getLogger(DefaultFileSystemMaster.class);
   private static final Set<Class<? extends Server>> DEPS =
       ImmutableSet.<Class<? extends Server>>of(BlockMaster.class);
@@ -278,7 +284,7 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
    */
 
   /** Handle the block index info. */
-  private KratiDataStore mBlockIndexStore = null;
+  private BlockZoneMapStore mZoneMapStore = null;
   private HashStore mValueStore = null;
   private HashStore mPathStore = null;
 
@@ -318,6 +324,30 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
   /** Serializer that transforms entry to byte array.*/
   private JavaSerializer mSerializer;
 
+  /**
+   * Directory id to the summary of the UDM and projected datasets of all files in its subtree.
+   * Rebuilt on replay.
+   */
+  private final Map<Long, UDMSummary> mSubtreeSummaries = new ConcurrentHashMap<>();
+
+  /** File id to the projection of the HDF5 groups and datasets recorded in its UDM. */
+  private final Map<Long, HDF5Projection> mProjections = new ConcurrentHashMap<>();
+
+  /** Name prefix of the UDM images, followed by the sequence number of their checkpoint. */
+  private static final String UDM_IMAGE_PREFIX = "UDMImage.";
+
+  /**
+   * Directory of the UDM images written with every checkpoint. It is the versioned journal folder
+   * of this master, so formatting the journal removes them.
+   */
+  private File mUDMImageDir = null;
+
+  /** The mapped UDM image, only held while the inodes of its checkpoint are replayed. */
+  private UDMImage mUDMImage = null;
+
+  /** File of the mapped UDM image. */
+  private File mUDMImageFile = null;
+
   /**
    * The service that checks for inode files with ttl set. We store it here so that it can be
    * accessed from tests.
@@ -360,16 +390,23 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
   DefaultFileSystemMaster(BlockMaster blockMaster, JournalSystem journalSystem,
       ExecutorServiceFactory executorServiceFactory) {
     super(journalSystem, new SystemClock(), executorServiceFactory);
-    File targetfile;
     try {
       String storepath = Configuration.get(PropertyKey.MASTER_JOURNAL_FOLDER);
-      targetfile = new File(storepath.concat("/BlockIndexStore"));
-      mBlockIndexStore = new KratiDataStore(targetfile, 10240);
+      mZoneMapStore = new BlockZoneMapStore(new File(storepath.concat("/ZoneMapStore")));
+      File blockIndexStore = new File(storepath.concat("/BlockIndexStore"));
+      if (blockIndexStore.exists()) {
+        // Entries of the old per-block KratiDataStore are not converted to zone maps
+        LOG.warn("Block index store {} is no longer read. Block indexes written before the zone "
+            + "map store are lost until their files are indexed again; the directory can then "
+            + "be deleted.", blockIndexStore);
+      }
       mValueStore = new HashStore(new File(storepath.concat("/ValueStore")), 10240);
       mPathStore = new HashStore(new File(storepath.concat("/PathStore")), 10240);
+      mUDMImageDir = new File(storepath, Constants.FILE_SYSTEM_MASTER_NAME + File.separator
+          + UfsJournal.VERSION);
       mSerializer = new JavaSerializer<HashMap>();
     } catch (Exception e) {
-      LOG.warn("Get KratiDataStore failed.", e);
+      LOG.warn("Get index store failed.", e);
     }
     mBlockMaster = blockMaster;
     mDirectoryIdGenerator = new InodeDirectoryIdGenerator(mBlockMaster);
@@ -417,6 +454,7 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
     if (entry.hasInodeFile()) {
       //LOG.info("Metadata Test: Add file entry once");
       mInodeTree.addInodeFileFromJournal(entry.getInodeFile());
+      applyUDMImage(entry.getInodeFile().getId());
       // Add the file to TTL buckets, the insert automatically rejects files w/ Constants.NO_TTL
       InodeFileEntry inodeFileEntry = entry.getInodeFile();
       if (inodeFileEntry.hasTtl()) {
@@ -431,10 +469,13 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
           mTtlBuckets.insert(InodeDirectory.fromJournalEntry(inodeDirectoryEntry));
         }
         mInodeTree.addInodeDirectoryFromJournal(entry.getInodeDirectory());
+        applyUDMImage(entry.getInodeDirectory().getId());
       } catch (AccessControlException e) {
         throw new RuntimeException(e);
       }
     } else if (entry.hasInodeDirectoryIdGenerator()) {
+      // A checkpoint holds this entry right after its inodes, which ends the use of its image
+      closeUDMImage();
       mDirectoryIdGenerator.initFromJournalEntry(entry.getInodeDirectoryIdGenerator());
     } else if (entry.hasReinitializeFile()) {
       resetBlockFileFromEntry(entry.getReinitializeFile());
@@ -504,6 +545,9 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
   @Override
   public void resetState() {
     mInodeTree.reset();
+    mSubtreeSummaries.clear();
+    mProjections.clear();
+    closeUDMImage();
     String rootUfsUri = Configuration.get(PropertyKey.MASTER_MOUNT_TABLE_ROOT_UFS);
     Map<String, String> rootUfsConf =
         Configuration.getNestedProperties(PropertyKey.MASTER_MOUNT_TABLE_ROOT_OPTION);
@@ -528,6 +572,7 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
 
   @Override
   public Iterator<JournalEntry> getJournalEntryIterator() {
+    // Inode entries do not carry UDM, it is restored from the image of the checkpoint
     return Iterators.concat(mInodeTree.getJournalEntryIterator(),
         CommonUtils.singleElementIterator(mDirectoryIdGenerator.toJournalEntry()),
         // The mount table should be written to the checkpoint after the inodes are written, so that
@@ -539,6 +584,8 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
   @Override
   public void start(Boolean isPrimary) throws IOException {
     super.start(isPrimary);
+    // The checkpoint has been replayed, later inodes are never in the image
+    closeUDMImage();
     if (isPrimary) {
       LOG.info("Starting fs master as primary");
 
@@ -593,6 +640,14 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
       mAsyncAuditLogWriter.stop();
       mAsyncAuditLogWriter = null;
     }
+    if (mZoneMapStore != null) {
+      try {
+        // Keeps the zone map log short for the next start
+        mZoneMapStore.checkpoint();
+      } catch (IOException e) {
+        LOG.warn("Failed to checkpoint the zone map store.", e);
+      }
+    }
     super.stop();
   }
 
@@ -770,6 +825,12 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
       // If the file already exists, then metadata does not need to be loaded,
       // otherwise load metadata.
       if (!inodePath.fullPathExists()) {
+        // Objects inside a projected HDF5 file are resolved without going to the UFS
+        List<FileInfo> projected = listProjectedStatus(inodePath, false, null, null);
+        if (projected != null) {
+          auditContext.setSucceeded(true);
+          return projected.get(0);
+        }
         checkLoadMetadataOptions(options.getLoadMetadataType(), inodePath.getUri());
         loadMetadataIfNotExistAndJournal(inodePath,
             LoadMetadataOptions.defaults().setCreateAncestors(true), journalContext);
@@ -789,6 +850,12 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
       }
       auditContext.setSrcInode(inodePath.getInode()).setSucceeded(true);
       return fileInfo;
+    } catch (FileDoesNotExistException | InvalidPathException e) {
+      List<FileInfo> projected = listProjectedStatus(path, false, null, null);
+      if (projected == null) {
+        throw e;
+      }
+      return projected.get(0);
     }
   }
 
@@ -853,32 +920,41 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
   private List<FileBlockInfo> queryFileBlockInfoListInternal(LockedInodePath inodePath,
       boolean isPersisted, String var, double max,
           double min) throws InvalidPathException, FileDoesNotExistException {
-    String mkey;
-    long blockid;
     long querylength = 0;
-    IndexInfo mBlockIndex;
     InodeFile file = inodePath.getInodeFile();
-    HashMap<String, IndexInfo> blockIndexs = file.getBlockIndexs();
     List<BlockInfo> blockInfoList = mBlockMaster.getBlockInfoList(file.getBlockIds());
     List<FileBlockInfo> ret = new ArrayList<>();
-    for (BlockInfo blockInfo : blockInfoList) {
-      blockid = blockInfo.getBlockId();
-      mkey = (Long.toString(blockid)).concat(var);
-      //mBlockIndex = blockIndexs.get(mkey);
-      mBlockIndex = mBlockIndexStore.get(mkey);
-      if (mBlockIndex == null) {
+    try (BlockZoneMapStore.ColumnGroup zoneMap =
+        mZoneMapStore.get(file.getBlockContainerId(), var)) {
+      int indexed =
+          zoneMap == null ? 0 : Math.min(zoneMap.getPrefixLength(), blockInfoList.size());
+      if (indexed < blockInfoList.size()) {
         LOG.info("Cureent block list contains no var: {} info", var);
-        break;
       }
       if (isPersisted) {
-        querylength += blockInfo.getLength();
-        ret.add(generateFileBlockInfo(inodePath, blockInfo));
-      } else {
-        if (mBlockIndex.getMaxValue() >= min && mBlockIndex.getMinValue() <= max) {
+        for (int i = 0; i < indexed; i++) {
+          querylength += blockInfoList.get(i).getLength();
+          ret.add(generateFileBlockInfo(inodePath, blockInfoList.get(i)));
+        }
+      } else if (indexed > 0) {
+        int[] hits = new int[zoneMap.getPrefixLength()];
+        int count = zoneMap.scan(min, max, false, hits);
+        for (int i = 0; i < count && hits[i] < indexed; i++) {
+          BlockInfo blockInfo = blockInfoList.get(hits[i]);
           querylength += blockInfo.getLength();
           ret.add(generateFileBlockInfo(inodePath, blockInfo));
         }
       }
+    } catch (IOException e) {
+      // Without the zone map any block may hold the value, so none is pruned
+      LOG.error("Failed to read the zone map of var {} of {}, returning all blocks", var,
+          inodePath.getUri(), e);
+      querylength = 0;
+      ret.clear();
+      for (BlockInfo blockInfo : blockInfoList) {
+        querylength += blockInfo.getLength();
+        ret.add(generateFileBlockInfo(inodePath, blockInfo));
+      }
     }
     String tmpkey = inodePath.getUri().toString();
     //if (!mQueryLength.containsKey(tmpkey)) {
@@ -901,86 +977,49 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
   private List<Long> queryFileBlockIdList(LockedInodePath inodePath,
       String var, double max, double min, boolean augmented)
           throws InvalidPathException, FileDoesNotExistException {
-    String mkey;
-    long blockid;
-    long querylength = 0;
-    double firstmin = 0;
-    double firstmax = 0;
-    double range = 1;
-    boolean firstBlock = true;
-    long tmpbitmap = 0x0000000000000000L;
-    IndexInfo mBlockIndex;
     InodeFile file = inodePath.getInodeFile();
-    //HashMap<String, IndexInfo> blockIndexs = file.getBlockIndexs();
-    List<BlockInfo> blockInfoList = mBlockMaster.getBlockInfoList(file.getBlockIds());
+    List<Long> blockIds = file.getBlockIds();
     List<Long> ret = new ArrayList<>();
-    for (BlockInfo blockInfo : blockInfoList) {
-      blockid = blockInfo.getBlockId();
-      mkey = (Long.toString(blockid)).concat(var);
-      //mBlockIndex = blockIndexs.get(mkey);
-      mBlockIndex = mBlockIndexStore.get(mkey);
-      if (mBlockIndex == null) {
+    try (BlockZoneMapStore.ColumnGroup zoneMap =
+        mZoneMapStore.get(file.getBlockContainerId(), var)) {
+      if (zoneMap == null) {
         LOG.info("Cureent block list contains no var: {} info", var);
-        break;
+        return ret;
       }
-      //Init augmented index info
-      if (firstBlock) {
-        firstmin = mBlockIndex.getMinValue();
-        firstmax = mBlockIndex.getMaxValue();
-        range = ((firstmax - firstmin) == 0) ? 1 : ((firstmax - firstmin) / 64);
-        firstBlock = false;
-      }
-      if (mBlockIndex != null) {
-        if (mBlockIndex.getBlockId() == blockid) {
-          LOG.info("Get Block index info");
-        } else {
-          LOG.info("Wrong block!!!");
-          //ret.add(generateFileBlockInfo(inodePath, blockInfo));
-          break;
-        }
-        if (mBlockIndex.getMaxValue() < min || mBlockIndex.getMinValue() > max) {
-          LOG.info("Block {} contains no value to satisfy the query", blockid);
-        } else {
-          //Augmented index
-          if (augmented) {
-            int t1 = ((min - firstmin) < 0) ? 63 :
-                (63 - (int) ((min - firstmin) / range));
-            int t2 = ((max - firstmin) < 0) ? 63 :
-                (63 - (int) ((max - firstmin) / range));
-            if (t1 < 0) {
-              t1 = 0;
-            }
-            if (t2 < 0) {
-              t2 = 0;
-            }
-            for (int i = t2; i <= t1; i++) {
-              tmpbitmap |= (1L << i);
-            }
-            if ((tmpbitmap & mBlockIndex.getBitmap()) != 0) {
-              LOG.info("Query range, t2: {}, t1: {}, bitmap: {}", t2, t1, tmpbitmap);
-              LOG.info("Block {} contains the value to satisfy the query, augmented index: {}",
-                  blockid, mBlockIndex.getBitmap());
-              querylength += blockInfo.getLength();
-              ret.add(blockid);
-            } else {
-              LOG.info("Query range, t2: {}, t1: {}, bitmap: {}", t2, t1, tmpbitmap);
-              LOG.info("Block {} contains no value to satisfy the query, augmented index: {}",
-                  blockid, mBlockIndex.getBitmap());
-            }
-          } else {
-            LOG.info("Block {} contains the value to satisfy the query", blockid);
-            querylength += blockInfo.getLength();
-            ret.add(blockid);
-          }
-        }
-      } else {
-        LOG.info("Get Block index info is null, BlockId is {}, query var name is {}",
-            blockid, var);
+      // One scan over the zone map of the file instead of a lookup per block
+      int[] hits = new int[zoneMap.getPrefixLength()];
+      int count = zoneMap.scan(min, max, augmented, hits);
+      for (int i = 0; i < count && hits[i] < blockIds.size(); i++) {
+        ret.add(blockIds.get(hits[i]));
       }
+    } catch (IOException e) {
+      // Without the zone map any block may hold the value, so none is pruned
+      LOG.error("Failed to read the zone map of var {} of {}, returning all blocks", var,
+          inodePath.getUri(), e);
+      return new ArrayList<>(blockIds);
     }
+    LOG.info("{} of {} blocks contain the value to satisfy the query, augmented index: {}",
+        ret.size(), blockIds.size(), augmented);
     return ret;
   }
 
+  /**
+   * Queries the block ids of a file without permission checks. Used by the master benchmark.
+   * @param path the path of the file
+   * @param var thr var name to query
+   * @param max the max value to query
+   * @param min the min value to query
+   * @param augmented whether to use augmented index
+   * @return the ids of the blocks which may hold values in the range
+   */
+  @VisibleForTesting
+  List<Long> queryFileBlockIdList(AlluxioURI path, String var, double max, double min,
+      boolean augmented) throws InvalidPathException, FileDoesNotExistException {
+    try (LockedInodePath inodePath = mInodeTree.lockFullInodePath(path, InodeTree.LockMode.READ)) {
+      return queryFileBlockIdList(inodePath, var, max, min, augmented);
+    }
+  }
+
   /**
    * @param inodePath the {@link LockedInodePath} to get the {@link FileInfo} for
    * @return the {@link FileInfo} for the given inode
@@ -999,7 +1038,7 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
         fileInfo.setFileBlockInfos(getFileBlockInfoListInternal(inodePath));
         //Add user defined metadata
         InodeFile inodefile = inodePath.getInodeFile();
-        if (inodefile.getUDM().size() != 0) {
+        if (inodefile.getUDM() != null && inodefile.getUDM().size() != 0) {
           LOG.info("Get user defined metadata {}", inodefile.getUDM());
           fileInfo.setUDM(inodefile.getUDM());
         }
@@ -1009,7 +1048,7 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
     }
     if (inode instanceof InodeDirectory) {
       InodeDirectory inodedirectory = (InodeDirectory) inode;
-      if (inodedirectory.getUDM().size() != 0) {
+      if (inodedirectory.getUDM() != null && inodedirectory.getUDM().size() != 0) {
         LOG.info("Get user defined metadata {}", inodedirectory.getUDM());
         fileInfo.setUDM(inodedirectory.getUDM());
       }
@@ -1062,6 +1101,13 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
           loadMetadataOptions.setLoadDirectChildren(false);
         }
       } else {
+        // Objects inside a projected HDF5 file are listed without going to the UFS
+        List<FileInfo> projected = listProjectedStatus(inodePath, true,
+            listStatusOptions.getUKey(), listStatusOptions.getUValue());
+        if (projected != null) {
+          auditContext.setSucceeded(true);
+          return projected;
+        }
         checkLoadMetadataOptions(listStatusOptions.getLoadMetadataType(), inodePath.getUri());
       }
 
@@ -1077,34 +1123,14 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
         List<String> typelist = listStatusOptions.getSType();
         LOG.info("Query files with key: {}, value: {}", keylist, valuelist);
         if (inode.isDirectory()) {
-          TempInodePathForDescendant tempInodePath = new TempInodePathForDescendant(inodePath);
           try {
             mPermissionChecker.checkPermission(Mode.Bits.EXECUTE, inodePath);
           } catch (AccessControlException e) {
             auditContext.setAllowed(false);
             throw e;
           }
-          for (Inode<?> child : ((InodeDirectory) inode).getChildren()) {
-            child.lockReadAndCheckParent(inode);
-            try {
-              // the path to child for getPath should already be locked.
-              tempInodePath.setDescendant(child, mInodeTree.getPath(child));
-              if (child.isDirectory() || queryUDM(child, keylist, valuelist, typelist)) {
-                ret.add(getFileInfoInternal(tempInodePath));
-              } else {
-                LOG.info("{} is not satisfied", child.getName());
-              }
-            } finally {
-              child.unlockRead();
-            }
-          }
-        } else {
-          if (queryUDM(inode, keylist, valuelist, typelist)) {
-            ret.add(getFileInfoInternal(inodePath));
-          } else {
-            LOG.info("{} is not satisfied", inode.getName());
-          }
         }
+        ret.addAll(queryStatusInternal(inodePath, keylist, valuelist, typelist));
       } else { //Normal actions
         if (inode.isDirectory()) {
           TempInodePathForDescendant tempInodePath = new TempInodePathForDescendant(inodePath);
@@ -1125,12 +1151,275 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
             }
           }
         } else {
-          ret.add(getFileInfoInternal(inodePath));
+          // A projected HDF5 file is listed like its root group
+          HDF5Projection projection = mProjections.get(inode.getId());
+          if (projection != null) {
+            ret.addAll(listProjectedObjects(inode, inodePath.getUri(), projection, "/", true,
+                null, null));
+          } else {
+            ret.add(getFileInfoInternal(inodePath));
+          }
         }
       }
       auditContext.setSucceeded(true);
       Metrics.FILE_INFOS_GOT.inc();
       return ret;
+    } catch (FileDoesNotExistException | InvalidPathException e) {
+      List<FileInfo> projected = listProjectedStatus(path, true,
+          listStatusOptions.getUKey(), listStatusOptions.getUValue());
+      if (projected == null) {
+        throw e;
+      }
+      return projected;
+    }
+  }
+
+  /**
+   * Resolves a path inside an HDF5 file whose groups and datasets are projected into the
+   * namespace, e.g. /dir/file.h5/group/dataset. Only called for paths without an inode, when
+   * the inode tree cannot even be traversed to the path.
+   * @param path the path to resolve
+   * @param listChildren whether to list the members of a group instead of the object itself
+   * @param keylist the key of query condition, null or empty for no query
+   * @param valuelist the value of query condition
+   * @return the {@link FileInfo} of the object or of its members, or null if the path is not
+   *         inside a projected file
+   * @throws AccessControlException if the file may not be read
+   */
+  @Nullable
+  private List<FileInfo> listProjectedStatus(AlluxioURI path, boolean listChildren,
+      @Nullable List<String> keylist, @Nullable List<String> valuelist)
+      throws AccessControlException {
+    AlluxioURI filePath = path.getParent();
+    while (filePath != null && !filePath.isRoot()) {
+      try (LockedInodePath inodePath =
+          mInodeTree.lockFullInodePath(filePath, InodeTree.LockMode.READ)) {
+        // The closest existing ancestor decides whether the path is inside a projected file
+        Inode<?> inode = inodePath.getInode();
+        HDF5Projection projection = inode.isFile() ? mProjections.get(inode.getId()) : null;
+        String objectPath = path.getPath().substring(filePath.getPath().length());
+        if (projection == null || !projection.contains(objectPath)) {
+          return null;
+        }
+        mPermissionChecker.checkPermission(Mode.Bits.READ, inodePath);
+        return listProjectedObjects(inode, filePath, projection, objectPath, listChildren,
+            keylist, valuelist);
+      } catch (InvalidPathException | FileDoesNotExistException e) {
+        filePath = filePath.getParent();
+      }
+    }
+    return null;
+  }
+
+  /**
+   * Resolves a path inside a projected HDF5 file from the locked part of the path which exists
+   * in the inode tree, before any metadata is loaded from the UFS for it. The caller has checked
+   * that the existing part may be read.
+   * @param inodePath the locked path, whose full path does not exist
+   * @param listChildren whether to list the members of a group instead of the object itself
+   * @param keylist the key of query condition, null or empty for no query
+   * @param valuelist the value of query condition
+   * @return the {@link FileInfo} of the object or of its members, or null if the path is not
+   *         inside a projected file
+   */
+  @Nullable
+  private List<FileInfo> listProjectedStatus(LockedInodePath inodePath, boolean listChildren,
+      @Nullable List<String> keylist, @Nullable List<String> valuelist)
+      throws FileDoesNotExistException {
+    List<Inode<?>> inodes = inodePath.getInodeList();
+    Inode<?> inode = inodes.get(inodes.size() - 1);
+    HDF5Projection projection = inode.isFile() ? mProjections.get(inode.getId()) : null;
+    if (projection == null) {
+      return null;
+    }
+    AlluxioURI filePath = mInodeTree.getPath(inode);
+    String objectPath = inodePath.getUri().getPath().substring(filePath.getPath().length());
+    if (!projection.contains(objectPath)) {
+      return null;
+    }
+    return listProjectedObjects(inode, filePath, projection, objectPath, listChildren, keylist,
+        valuelist);
+  }
+
+  /**
+   * @param file the projected HDF5 file
+   * @param filePath the path of the file
+   * @param projection the projection of the file
+   * @param objectPath the path of an object of the projection
+   * @param listChildren whether to list the members of a group instead of the object itself
+   * @param keylist the key of query condition, null or empty for no query
+   * @param valuelist the value of query condition
+   * @return the {@link FileInfo} of the object or of its members
+   */
+  private List<FileInfo> listProjectedObjects(Inode<?> file, AlluxioURI filePath,
+      HDF5Projection projection, String objectPath, boolean listChildren,
+      @Nullable List<String> keylist, @Nullable List<String> valuelist)
+      throws FileDoesNotExistException {
+    List<FileInfo> ret = new ArrayList<>();
+    if (!listChildren) {
+      ret.add(getProjectedFileInfo(file, filePath, projection, objectPath));
+    } else {
+      for (String listed : projection.list(objectPath)) {
+        if (keylist == null || keylist.isEmpty() || !projection.isDataset(listed)
+            || queryProjectedObject(projection, listed, keylist, valuelist)) {
+          ret.add(getProjectedFileInfo(file, filePath, projection, listed));
+        }
+      }
+    }
+    Metrics.FILE_INFOS_GOT.inc();
+    return ret;
+  }
+
+  /**
+   * Builds the read-only {@link FileInfo} of a group or dataset inside a projected HDF5 file.
+   * Ownership and mount information are inherited from the file. Projected objects have no
+   * inode, blocks or file id of their own, so they can only be addressed by path.
+   * @param file the HDF5 file
+   * @param filePath the path of the file
+   * @param projection the projection of the file
+   * @param objectPath the path of the object inside the file
+   * @return the {@link FileInfo} of the object
+   */
+  private FileInfo getProjectedFileInfo(Inode<?> file, AlluxioURI filePath,
+      HDF5Projection projection, String objectPath) throws FileDoesNotExistException {
+    FileInfo fileInfo =
+        file.generateClientFileInfo(PathUtils.concatPath(filePath.getPath(), objectPath));
+    HashMap<String, String> attributes = projection.getAttributes(objectPath);
+    if (attributes == null) {
+      attributes = new HashMap<>();
+    }
+    boolean isDataset = projection.isDataset(objectPath);
+    fileInfo.setFileId(IdUtils.INVALID_FILE_ID);
+    fileInfo.setName(objectPath.substring(objectPath.lastIndexOf('/') + 1));
+    fileInfo.setFolder(!isDataset);
+    fileInfo.setMode(fileInfo.getMode() & ~0222);
+    fileInfo.setBlockIds(new ArrayList<Long>());
+    fileInfo.setFileBlockInfos(new ArrayList<FileBlockInfo>());
+    long length = 0;
+    if (attributes.containsKey(HDF5Projection.STORAGE_SIZE)) {
+      try {
+        length = Long.parseLong(attributes.get(HDF5Projection.STORAGE_SIZE));
+      } catch (NumberFormatException e) {
+        LOG.warn("Invalid storage size of {}: {}", fileInfo.getPath(),
+            attributes.get(HDF5Projection.STORAGE_SIZE));
+      }
+    }
+    fileInfo.setLength(length);
+    fileInfo.setUDM(attributes);
+    MountTable.Resolution resolution;
+    try {
+      resolution = mMountTable.resolve(filePath);
+    } catch (InvalidPathException e) {
+      throw new FileDoesNotExistException(e.getMessage(), e);
+    }
+    fileInfo.setUfsPath(resolution.getUri().toString());
+    fileInfo.setMountId(resolution.getMountId());
+    return fileInfo;
+  }
+
+  /**
+   * Check whether an object inside a projected HDF5 file satisfies the query condition.
+   * @param projection the projection of the file
+   * @param objectPath the path of the object inside the file
+   * @param keylist the key of query condition
+   * @param valuelist the value of query condition
+   */
+  private boolean queryProjectedObject(HDF5Projection projection, String objectPath,
+      List<String> keylist, List<String> valuelist) {
+    Map<String, String> attributes = projection.getAttributes(objectPath);
+    if (attributes == null) {
+      return false;
+    }
+    for (int i = 0; i < keylist.size(); i++) {
+      String tvalue = attributes.get(keylist.get(i));
+      if (tvalue == null || !tvalue.equals(valuelist.get(i))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Lists the datasets inside a projected HDF5 file which satisfy the query condition.
+   * @param inodePath the locked path of the file
+   * @param keylist the key of query condition
+   * @param valuelist the value of query condition
+   * @return the {@link FileInfo} of every satisfied dataset
+   */
+  private List<FileInfo> queryProjectionInternal(LockedInodePath inodePath, List<String> keylist,
+      List<String> valuelist) throws FileDoesNotExistException {
+    Inode<?> inode = inodePath.getInode();
+    HDF5Projection projection = mProjections.get(inode.getId());
+    if (projection == null) {
+      return Collections.emptyList();
+    }
+    List<FileInfo> ret = new ArrayList<>();
+    for (String dataset : projection.getDatasets()) {
+      if (queryProjectedObject(projection, dataset, keylist, valuelist)) {
+        ret.add(getProjectedFileInfo(inode, inodePath.getUri(), projection, dataset));
+      }
+    }
+    return ret;
+  }
+
+  /**
+   * Lists the children of a directory, or the file itself, which satisfy a UDM query.
+   * @param inodePath the {@link LockedInodePath} to query
+   * @param keylist the key of query condition
+   * @param valuelist the value of query condition
+   * @param typelist the type of query condition
+   * @return the {@link FileInfo} of every satisfied file, projected HDF5 dataset and every
+   *         directory that may hold one
+   */
+  private List<FileInfo> queryStatusInternal(LockedInodePath inodePath, List<String> keylist,
+      List<String> valuelist, List<String> typelist)
+      throws FileDoesNotExistException, AccessControlException, InvalidPathException {
+    List<FileInfo> ret = new ArrayList<>();
+    Inode<?> inode = inodePath.getInode();
+    if (inode.isDirectory()) {
+      TempInodePathForDescendant tempInodePath = new TempInodePathForDescendant(inodePath);
+      for (Inode<?> child : ((InodeDirectory) inode).getChildren()) {
+        child.lockReadAndCheckParent(inode);
+        try {
+          // the path to child for getPath should already be locked.
+          tempInodePath.setDescendant(child, mInodeTree.getPath(child));
+          if (child.isDirectory() ? subtreeMightMatch(child, keylist, valuelist)
+              : queryUDM(child, keylist, valuelist, typelist)) {
+            ret.add(getFileInfoInternal(tempInodePath));
+          } else {
+            LOG.info("{} is not satisfied", child.getName());
+          }
+          if (child.isFile()) {
+            ret.addAll(queryProjectionInternal(tempInodePath, keylist, valuelist));
+          }
+        } finally {
+          child.unlockRead();
+        }
+      }
+    } else {
+      if (queryUDM(inode, keylist, valuelist, typelist)) {
+        ret.add(getFileInfoInternal(inodePath));
+      } else {
+        LOG.info("{} is not satisfied", inode.getName());
+      }
+      ret.addAll(queryProjectionInternal(inodePath, keylist, valuelist));
+    }
+    return ret;
+  }
+
+  /**
+   * Runs a UDM query on a path without permission checks or metadata loading. Used by the master
+   * benchmark, which drives the query path without a client.
+   * @param path the path to query
+   * @param keylist the key of query condition
+   * @param valuelist the value of query condition
+   * @return the query result, see {@link #queryStatusInternal}
+   */
+  @VisibleForTesting
+  List<FileInfo> queryStatus(AlluxioURI path, List<String> keylist, List<String> valuelist)
+      throws FileDoesNotExistException, AccessControlException, InvalidPathException {
+    try (LockedInodePath inodePath = mInodeTree.lockFullInodePath(path, InodeTree.LockMode.READ)) {
+      return queryStatusInternal(inodePath, keylist, valuelist, Collections.<String>emptyList());
     }
   }
 
@@ -1184,6 +1473,123 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
     }
   }
 
+  /**
+   * Check whether any file under the given directory may satisfy the query condition. As before
+   * subtree summaries existed, a directory is listed unless its summary holds UDM and rules the
+   * query out, so directories without any UDM below them are still returned. The attributes of
+   * projected HDF5 datasets are summarized too, so their queries prune the same way.
+   * @param directory the target directory
+   * @param keylist the key of query condition
+   * @param valuelist the value of query condition
+   * @return false if the subtree summary rules out every file under the directory
+   */
+  private boolean subtreeMightMatch(Inode<?> directory, List<String> keylist,
+      List<String> valuelist) {
+    UDMSummary summary = mSubtreeSummaries.get(directory.getId());
+    return summary == null || summary.isEmpty() || summary.mightContain(keylist, valuelist);
+  }
+
+  /**
+   * @param inode the inode to summarize
+   * @return the summary of the UDM contributed by the inode and its descendants, or null if none
+   */
+  @Nullable
+  private UDMSummary getSubtreeContribution(Inode<?> inode) {
+    if (inode.isDirectory()) {
+      return mSubtreeSummaries.get(inode.getId());
+    }
+    Map<String, String> udm = ((InodeFile) inode).getUDM();
+    HDF5Projection projection = mProjections.get(inode.getId());
+    if ((udm == null || udm.isEmpty()) && projection == null) {
+      return null;
+    }
+    UDMSummary summary = new UDMSummary();
+    if (udm != null) {
+      summary.add(udm);
+    }
+    if (projection != null) {
+      for (Map<String, String> dataset : projection.getDatasetAttributes()) {
+        summary.add(dataset);
+      }
+    }
+    return summary;
+  }
+
+  /**
+   * @param directory the directory whose subtree summary to get
+   * @return the subtree summary of the directory, created if absent
+   */
+  private UDMSummary getOrCreateSubtreeSummary(Inode<?> directory) {
+    UDMSummary summary = mSubtreeSummaries.get(directory.getId());
+    if (summary == null) {
+      summary = new UDMSummary();
+      UDMSummary existing = mSubtreeSummaries.putIfAbsent(directory.getId(), summary);
+      if (existing != null) {
+        summary = existing;
+      }
+    }
+    return summary;
+  }
+
+  /**
+   * Applies a change of the UDM of one file to the subtree summaries of the given directories.
+   * @param ancestors the directories above the file
+   * @param oldUDM the UDM of the file before the change
+   * @param newUDM the UDM of the file after the change
+   */
+  private void updateSubtreeSummaries(List<Inode<?>> ancestors, Map<String, String> oldUDM,
+      Map<String, String> newUDM) {
+    for (Inode<?> ancestor : ancestors) {
+      UDMSummary summary = getOrCreateSubtreeSummary(ancestor);
+      summary.remove(oldUDM);
+      summary.add(newUDM);
+    }
+  }
+
+  /**
+   * Applies a change of the projected datasets of one file to the subtree summaries of the given
+   * directories.
+   * @param ancestors the directories above the file
+   * @param oldDatasets the attributes of the changed datasets before the change
+   * @param newDatasets the attributes of the changed datasets after the change
+   */
+  private void updateSubtreeSummaries(List<Inode<?>> ancestors,
+      List<Map<String, String>> oldDatasets, List<Map<String, String>> newDatasets) {
+    for (Inode<?> ancestor : ancestors) {
+      UDMSummary summary = getOrCreateSubtreeSummary(ancestor);
+      for (Map<String, String> dataset : oldDatasets) {
+        summary.remove(dataset);
+      }
+      for (Map<String, String> dataset : newDatasets) {
+        summary.add(dataset);
+      }
+    }
+  }
+
+  /**
+   * Moves the subtree summary contributed by an inode between two ancestor chains.
+   * @param inode the moved inode
+   * @param srcAncestors the inodes on the source path, the moved inode is skipped
+   * @param dstAncestors the inodes on the destination path, the moved inode is skipped
+   */
+  private void moveSubtreeSummary(Inode<?> inode, List<Inode<?>> srcAncestors,
+      List<Inode<?>> dstAncestors) {
+    UDMSummary contribution = getSubtreeContribution(inode);
+    if (contribution == null || contribution.isEmpty()) {
+      return;
+    }
+    for (Inode<?> ancestor : srcAncestors) {
+      if (ancestor != inode) {
+        getOrCreateSubtreeSummary(ancestor).subtract(contribution);
+      }
+    }
+    for (Inode<?> ancestor : dstAncestors) {
+      if (ancestor != inode) {
+        getOrCreateSubtreeSummary(ancestor).merge(contribution);
+      }
+    }
+  }
+
   /**
    * Checks the {@link LoadMetadataType} to determine whether or not to proceed in loading
    * metadata. This method assumes that the path does not exist in Alluxio namespace, and will
@@ -1767,6 +2173,38 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
           failedUris.add(alluxioUriToDel.toString());
         }
       }
+      // Drop the UDM of deleted files from the subtree summaries of the directories above them
+      Map<Long, Inode> delInodesById = new HashMap<>();
+      for (Pair<AlluxioURI, Inode> delInodePair : delInodes) {
+        delInodesById.put(delInodePair.getSecond().getId(), delInodePair.getSecond());
+      }
+      List<Inode<?>> ancestors = inodePath.getInodeList();
+      ancestors = ancestors.subList(0, ancestors.size() - 1);
+      for (Pair<AlluxioURI, Inode> delInodePair : inodesToDelete) {
+        Inode<?> delInode = delInodePair.getSecond();
+        if (delInode.isDirectory()) {
+          mSubtreeSummaries.remove(delInode.getId());
+          continue;
+        }
+        HDF5Projection projection = mProjections.remove(delInode.getId());
+        Map<String, String> udm = ((InodeFile) delInode).getUDM();
+        if ((udm == null || udm.isEmpty()) && projection == null) {
+          continue;
+        }
+        List<Inode<?>> summaryDirs = new ArrayList<>(ancestors);
+        Inode<?> parent = delInodesById.get(delInode.getParentId());
+        while (parent != null) {
+          summaryDirs.add(parent);
+          parent = delInodesById.get(parent.getParentId());
+        }
+        if (udm != null && !udm.isEmpty()) {
+          updateSubtreeSummaries(summaryDirs, udm, Collections.<String, String>emptyMap());
+        }
+        if (projection != null) {
+          updateSubtreeSummaries(summaryDirs, projection.getDatasetAttributes(),
+              Collections.<Map<String, String>>emptyList());
+        }
+      }
       // Delete Inodes
       for (Pair<AlluxioURI, Inode> delInodePair : inodesToDelete) {
         Inode delInode = delInodePair.getSecond();
@@ -1795,6 +2233,7 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
     for (Inode<?> inode : deletedInodes) {
       if (inode.isFile()) {
         deletedBlockIds.addAll(((InodeFile) inode).getBlockIds());
+        mZoneMapStore.remove(((InodeFile) inode).getBlockContainerId());
       }
     }
     mBlockMaster.removeBlocks(deletedBlockIds, true /* delete */);
@@ -2280,6 +2719,7 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
     // 3. Do UFS operations if necessary.
     // 4. Remove the source inode (reverting the name) from the source parent.
     // 5. Set the last modification times for both source and destination parent inodes.
+    // 6. Move the UDM subtree summary of the source inode to the destination ancestors.
 
     Inode<?> srcInode = srcInodePath.getInode();
     AlluxioURI srcPath = srcInodePath.getUri();
@@ -2384,6 +2824,9 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
     // correct behavior when multiple files are being renamed within a directory.
     dstParentInode.setLastModificationTimeMs(options.getOperationTimeMs());
     srcParentInode.setLastModificationTimeMs(options.getOperationTimeMs());
+
+    // 6. Move the UDM subtree summary of the source inode to the destination ancestors.
+    moveSubtreeSummary(srcInode, srcInodePath.getInodeList(), dstInodePath.getInodeList());
     Metrics.PATHS_RENAMED.inc();
   }
 
@@ -3307,24 +3750,16 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
     }
     //JournalEntry tmpentry = JournalEntry.newBuilder().setSetAttribute(builder).build();
     if (options.mUDM) {
-      List<String> keylist = options.getUDMKey();
-      List<String> valuelist = options.getUDMValue();
-      int size = keylist.size();
-      HashMap<String, String> currnetUDM = new HashMap<String, String>();
+      // setAttributeInternal has applied the change, so journal the resulting UDM together with
+      // the HDF5 object records of a file, which are kept apart from its UDM
+      // A file may have records but no UDM yet, e.g. when the extractor only projects it
       Inode<?> inode = inodePath.getInode();
+      HashMap<String, String> currnetUDM;
       if (inode instanceof InodeFile) {
-        currnetUDM = ((InodeFile) inode).getUDM();
-      } else {
-        currnetUDM = ((InodeDirectory) inode).getUDM();
-      }
-      if (!options.mDeleteAttribute) {
-        for (int i = 0; i < size; i++) {
-          currnetUDM.put(keylist.get(i), valuelist.get(i));
-        }
+        currnetUDM = HDF5Projection.withRecords(((InodeFile) inode).getUDM(),
+            mProjections.get(inode.getId()));
       } else {
-        for (int i = 0; i < size; i++) {
-          currnetUDM.remove(keylist.get(i));
-        }
+        currnetUDM = HDF5Projection.withRecords(((InodeDirectory) inode).getUDM(), null);
       }
       alluxio.core.protobuf.com.google.protobuf.ByteString tmpbytes =
           alluxio.core.protobuf.com.google.protobuf.ByteString.copyFrom(
@@ -3427,47 +3862,8 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
       }
     }
     if (options.mShouldindex) {
-      int i = 0;
-      List<Long> blockidlist = options.getBlockId();
-      List<Double> maxlist = options.getBlockMax();
-      List<Double> minlist = options.getBlockMin();
-      List<String> varlist = options.getBlockVar();
-      List<Long> auglist = options.getAugIndex();
-      long blockid;
-      double max;
-      double min;
-      long tmpbitmap;
-      String varname;
-      String mkey;
-      IndexInfo blockindex;
-      for (i = 0; i < maxlist.size(); i++) {
-        if (varlist == null) {
-          LOG.info("Varlist is null!");
-        }
-        blockid = blockidlist.get(i);
-        varname = varlist.get(i);
-        max = maxlist.get(i);
-        min = minlist.get(i);
-        tmpbitmap = auglist.get(i);
-        blockindex = new IndexInfo(blockid, max, min, varname);
-        blockindex.setBitmap(tmpbitmap);
-        LOG.info(
-            "Add Block index: BlockId: {}, VarName: {}, Maxvalue: {}, Minvalue: {}, Bitmap: {}",
-            blockid, varname, max, min, tmpbitmap);
-        mkey = (Long.toString(blockid)).concat(varname);
-        //((InodeFile) inode).addBlockIndex(mkey, blockindex);
-        try {
-          mBlockIndexStore.put(mkey, blockindex);
-        } catch (Exception e) {
-          LOG.warn("Insert KV to Hash data base failed.", e);
-        }
-      }
-      try {
-        mBlockIndexStore.sync();
-      } catch (Exception e) {
-        LOG.warn("Data base sync failed.", e);
-      }
-      LOG.info("Add Block index success");
+      addBlockIndexInternal(options.getBlockId(), options.getBlockMax(), options.getBlockMin(),
+          options.getBlockVar(), options.getAugIndex());
     } else {
       LOG.info("Block index info is null");
     }
@@ -3475,12 +3871,72 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
       List<String> keylist = options.getUDMKey();
       List<String> valuelist = options.getUDMValue();
       if (inode instanceof InodeFile) {
-        if (!options.mDeleteAttribute) {
-          ((InodeFile) inode).addUDM(keylist, valuelist);
-          LOG.info("Add user-defined metadata : Key : {}, Value : {}", keylist, valuelist);
+        // HDF5 object records go to the projection of the file, the rest to its UDM
+        List<String> udmKeys = new ArrayList<>();
+        List<String> udmValues = new ArrayList<>();
+        HDF5Projection projection = mProjections.get(inode.getId());
+        // Only the datasets named by the records change in the subtree summaries
+        Set<String> recordObjects = new HashSet<>();
+        for (String key : keylist) {
+          if (HDF5Projection.isRecord(key)) {
+            recordObjects.add(HDF5Projection.getObjectPath(key));
+          }
+        }
+        List<Map<String, String>> oldDatasets = projection == null
+            ? Collections.<Map<String, String>>emptyList()
+            : projection.getDatasetAttributes(recordObjects);
+        for (int i = 0; i < keylist.size(); i++) {
+          String key = keylist.get(i);
+          if (!HDF5Projection.isRecord(key)) {
+            udmKeys.add(key);
+            if (!options.mDeleteAttribute) {
+              udmValues.add(valuelist.get(i));
+            }
+          } else if (options.mDeleteAttribute) {
+            if (projection != null) {
+              projection.remove(key);
+            }
+          } else {
+            if (projection == null) {
+              projection = new HDF5Projection();
+            }
+            projection.put(key, valuelist.get(i));
+          }
+        }
+        boolean projected = projection != null && !projection.isEmpty();
+        if (projected) {
+          mProjections.put(inode.getId(), projection);
         } else {
-          ((InodeFile) inode).deleteUDM(keylist);
-          LOG.info("Delete user-defined metadata : Key : {}, Value : {}", keylist, valuelist);
+          mProjections.remove(inode.getId());
+        }
+        Map<String, String> oldUDM = new HashMap<>();
+        if (((InodeFile) inode).getUDM() != null) {
+          oldUDM.putAll(((InodeFile) inode).getUDM());
+        }
+        if (udmKeys.isEmpty()) {
+          LOG.info("Update {} HDF5 object records", keylist.size());
+        } else if (!options.mDeleteAttribute) {
+          ((InodeFile) inode).addUDM(udmKeys, udmValues);
+          LOG.info("Add user-defined metadata : Key : {}, Value : {}", udmKeys, udmValues);
+        } else {
+          ((InodeFile) inode).deleteUDM(udmKeys);
+          LOG.info("Delete user-defined metadata : Key : {}", udmKeys);
+        }
+        // Keep the subtree summaries of all ancestors in sync, also when replaying the journal
+        Map<String, String> newUDM = ((InodeFile) inode).getUDM();
+        if (newUDM == null) {
+          newUDM = Collections.emptyMap();
+        }
+        List<Inode<?>> ancestors = inodePath.getInodeList();
+        ancestors = ancestors.subList(0, ancestors.size() - 1);
+        if (!oldUDM.equals(newUDM)) {
+          updateSubtreeSummaries(ancestors, oldUDM, newUDM);
+        }
+        List<Map<String, String>> newDatasets = projection == null
+            ? Collections.<Map<String, String>>emptyList()
+            : projection.getDatasetAttributes(recordObjects);
+        if (!oldDatasets.equals(newDatasets)) {
+          updateSubtreeSummaries(ancestors, oldDatasets, newDatasets);
         }
       } else {
         if (!options.mDeleteAttribute) {
@@ -3557,6 +4013,33 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
     return persistedInodes;
   }
 
+  /**
+   * Adds the per-block variable index of a file. The index is kept in the zone map store and is
+   * not journaled.
+   *
+   * @param blockidlist the ids of the indexed blocks
+   * @param maxlist the max value of the variable in each block
+   * @param minlist the min value of the variable in each block
+   * @param varlist the variable name of each entry
+   * @param auglist the augmented index bitmap of each entry
+   */
+  @VisibleForTesting
+  void addBlockIndexInternal(List<Long> blockidlist, List<Double> maxlist, List<Double> minlist,
+      List<String> varlist, List<Long> auglist) {
+    if (varlist == null) {
+      LOG.info("Varlist is null!");
+      return;
+    }
+    try {
+      // The whole call is logged and synced once
+      mZoneMapStore.put(blockidlist, maxlist, minlist, varlist, auglist);
+    } catch (Exception e) {
+      LOG.warn("Insert block index to zone map store failed.", e);
+      return;
+    }
+    LOG.info("Add Block index success: {} entries", blockidlist.size());
+  }
+
   /**
    * @param entry the entry to use
    * @throws FileDoesNotExistException if the file does not exist
@@ -3605,6 +4088,169 @@ public final class DefaultFileSystemMaster extends AbstractMaster implements Fil
     return mBlockMaster.getWorkerInfoList();
   }
 
+  @Override
+  public void openCheckpointImage(long sequenceNumber) throws IOException {
+    closeUDMImage();
+    if (sequenceNumber < 0 || mUDMImageDir == null) {
+      return;
+    }
+    File file = getUDMImageFile(sequenceNumber);
+    UDMImage image;
+    try {
+      image = UDMImage.open(file);
+    } catch (IOException e) {
+      throw new IOException(String.format("Failed to map UDM image %s of checkpoint %d.", file,
+          sequenceNumber), e);
+    }
+    if (image == null) {
+      if (!hasUDMImages()) {
+        // The checkpoint was written before the master wrote UDM images
+        LOG.warn("No UDM image for checkpoint {}, UDM of checkpointed inodes is not restored.",
+            sequenceNumber);
+        return;
+      }
+      // Replaying the checkpoint without its image would drop the UDM of checkpointed inodes
+      throw new IOException(String.format("UDM image %s of checkpoint %d is missing.", file,
+          sequenceNumber));
+    }
+    if (image.getCheckpointSequenceNumber() != sequenceNumber) {
+      image.close();
+      throw new IOException(String.format("UDM image %s belongs to checkpoint %d instead of "
+          + "checkpoint %d.", file, image.getCheckpointSequenceNumber(), sequenceNumber));
+    }
+    mUDMImage = image;
+    mUDMImageFile = file;
+  }
+
+  @Override
+  public void deleteCheckpointImages(long sequenceNumber) {
+    File[] files = mUDMImageDir == null ? null : mUDMImageDir.listFiles();
+    if (files == null) {
+      return;
+    }
+    for (File file : files) {
+      long imageSequenceNumber = getUDMImageSequenceNumber(file.getName());
+      if (imageSequenceNumber >= 0 && imageSequenceNumber < sequenceNumber && !file.delete()) {
+        LOG.warn("Failed to delete UDM image {} of an earlier checkpoint.", file);
+      }
+    }
+  }
+
+  @Override
+  public void writeCheckpointImage(long sequenceNumber) throws IOException {
+    if (mUDMImageDir == null || mInodeTree.getRoot() == null) {
+      return;
+    }
+    Map<Long, Map<String, String>> udms = new HashMap<>();
+    Stack<Inode<?>> inodes = new Stack<>();
+    inodes.push(mInodeTree.getRoot());
+    while (!inodes.isEmpty()) {
+      Inode<?> inode = inodes.pop();
+      Map<String, String> udm;
+      if (inode instanceof InodeFile) {
+        udm = ((InodeFile) inode).getUDM();
+      } else {
+        udm = ((InodeDirectory) inode).getUDM();
+        for (Inode<?> child : ((InodeDirectory) inode).getChildren()) {
+          inodes.push(child);
+        }
+      }
+      HashMap<String, String> image =
+          HDF5Projection.withRecords(udm, mProjections.get(inode.getId()));
+      if (!image.isEmpty()) {
+        udms.put(inode.getId(), image);
+      }
+    }
+    // The image of the latest committed checkpoint is kept until this checkpoint commits
+    UDMImage.write(getUDMImageFile(sequenceNumber), sequenceNumber, udms);
+  }
+
+  /**
+   * @param sequenceNumber the sequence number of a checkpoint
+   * @return the UDM image file of the checkpoint
+   */
+  private File getUDMImageFile(long sequenceNumber) {
+    return new File(mUDMImageDir, UDM_IMAGE_PREFIX + sequenceNumber);
+  }
+
+  /**
+   * @param name the name of a file in the UDM image directory
+   * @return the sequence number of the checkpoint of the image, or -1 if the file is no image;
+   *         a partly written image counts as an image
+   */
+  private static long getUDMImageSequenceNumber(String name) {
+    if (!name.startsWith(UDM_IMAGE_PREFIX)) {
+      return -1;
+    }
+    String sequenceNumber = name.substring(UDM_IMAGE_PREFIX.length());
+    if (sequenceNumber.endsWith(".tmp")) {
+      sequenceNumber = sequenceNumber.substring(0, sequenceNumber.length() - ".tmp".length());
+    }
+    try {
+      return Long.parseLong(sequenceNumber);
+    } catch (NumberFormatException e) {
+      return -1;
+    }
+  }
+
+  /**
+   * @return whether a UDM image of any checkpoint exists
+   */
+  private boolean hasUDMImages() {
+    String[] names = mUDMImageDir.list();
+    if (names != null) {
+      for (String name : names) {
+        if (getUDMImageSequenceNumber(name) >= 0 && !name.endsWith(".tmp")) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Restores the UDM of an inode replayed from a checkpoint from the UDM image. This goes through
+   * {@link #setAttributeInternal} so the subtree summaries and HDF5 projections are rebuilt too.
+   *
+   * @param inodeId the id of the replayed inode
+   * @throws IOException if the entries of the inode in the image are corrupt
+   */
+  private void applyUDMImage(long inodeId) throws IOException {
+    if (mUDMImage == null) {
+      return;
+    }
+    HashMap<String, String> udm;
+    try {
+      udm = mUDMImage.getUDM(inodeId);
+    } catch (IOException e) {
+      throw new IOException(String.format("Failed to decode UDM image %s.", mUDMImageFile), e);
+    }
+    if (udm == null || udm.isEmpty()) {
+      return;
+    }
+    SetAttributeOptions options = SetAttributeOptions.defaults();
+    options.setUDM(udm);
+    try (LockedInodePath inodePath = mInodeTree
+        .lockFullInodePath(inodeId, InodeTree.LockMode.WRITE)) {
+      setAttributeInternal(inodePath, true, inodePath.getInode().getLastModificationTimeMs(),
+          options);
+    } catch (AccessControlException | FileDoesNotExistException | InvalidPathException e) {
+      throw new RuntimeException(e);
+    }
+  }
+
+  private void closeUDMImage() {
+    if (mUDMImage != null) {
+      try {
+        mUDMImage.close();
+      } catch (IOException e) {
+        LOG.warn("Failed to close UDM image {}.", mUDMImageFile, e);
+      }
+      mUDMImage = null;
+      mUDMImageFile = null;
+    }
+  }
+
   /**
    * Class that contains metrics for FileSystemMaster.
    * This class is public because the counter names are referenced in
@@ -0,0 +1,434 @@
+/*
+ * The Alluxio Open Foundation licenses this work under the Apache License, version 2.0
+ * (the "License"). You may not use this work except in compliance with the License, which is
+ * available at www.apache.org/licenses/LICENSE-2.0
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied, as more fully set forth in the License.
+ *
+ * See the NOTICE file distributed with this work for information regarding copyright ownership.
+ */
+
+package alluxio.master.file;
+
+import alluxio.AlluxioURI;
+import alluxio.Configuration;
+import alluxio.Constants;
+import alluxio.PropertyKey;
+import alluxio.cli.Format;
+import alluxio.master.MasterRegistry;
+import alluxio.master.block.BlockMaster;
+import alluxio.master.block.BlockMasterFactory;
+import alluxio.master.file.options.CompleteFileOptions;
+import alluxio.master.file.options.CreateDirectoryOptions;
+import alluxio.master.file.options.CreateFileOptions;
+import alluxio.master.file.options.SetAttributeOptions;
+import alluxio.master.journal.JournalSystem;
+import alluxio.master.journal.ufs.UfsJournal;
+import alluxio.security.authentication.AuthenticatedClientUser;
+import alluxio.wire.FileInfo;
+
+import com.codahale.metrics.Counter;
+
+import java.io.File;
+import java.io.IOException;
+import java.net.URI;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.Random;
+import java.util.concurrent.Callable;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
+
+/**
+ * Standalone benchmark for the metadata hot paths of {@link DefaultFileSystemMaster}. It starts
+ * an in-process master on a local journal folder, populates a synthetic namespace and then runs a
+ * mix of UDM queries, block index queries and UDM mutations from many client threads.
+ *
+ * Parameters are passed as key=value pairs, e.g.
+ * <pre>
+ *   java alluxio.master.file.FileSystemMasterBenchmark journal=/tmp/bench depth=3 fanout=8
+ *       files=64 keys=4 cardinality=100 blocks=16 threads=32 ops=200000
+ *       mix=list:40,query:20,tree:5,block:30,set:5
+ * </pre>
+ * The journal folder is formatted before every run, so it must lie below java.io.tmpdir.
+ * The master logs every query at INFO, so run it with the master logger at WARN to measure the
+ * code rather than the logger.
+ */
+public final class FileSystemMasterBenchmark {
+  /** The variable name used for the per-block index entries. */
+  private static final String VAR_NAME = "var0";
+  private static final long BLOCK_SIZE = 64 * Constants.MB;
+
+  private static final String OP_LIST = "list";
+  private static final String OP_QUERY = "query";
+  private static final String OP_TREE = "tree";
+  private static final String OP_BLOCK = "block";
+  private static final String OP_SET = "set";
+
+  private final String mJournalFolder;
+  private final int mDepth;
+  private final int mFanout;
+  private final int mFilesPerDir;
+  private final int mKeysPerFile;
+  private final int mCardinality;
+  private final int mBlocksPerFile;
+  private final int mThreads;
+  private final int mOps;
+  private final String[] mMixOps;
+  private final int[] mMixWeights;
+
+  private final List<AlluxioURI> mLeafDirs = new ArrayList<>();
+  private final List<AlluxioURI> mAllDirs = new ArrayList<>();
+  private final List<AlluxioURI> mFiles = new ArrayList<>();
+
+  private MasterRegistry mRegistry;
+  private JournalSystem mJournalSystem;
+  private BlockMaster mBlockMaster;
+  private DefaultFileSystemMaster mFileSystemMaster;
+
+  private FileSystemMasterBenchmark(Map<String, String> args) {
+    mJournalFolder = get(args, "journal", "/tmp/alluxio-master-bench");
+    mDepth = Integer.parseInt(get(args, "depth", "3"));
+    mFanout = Integer.parseInt(get(args, "fanout", "8"));
+    mFilesPerDir = Integer.parseInt(get(args, "files", "64"));
+    mKeysPerFile = Integer.parseInt(get(args, "keys", "4"));
+    mCardinality = Integer.parseInt(get(args, "cardinality", "100"));
+    mBlocksPerFile = Integer.parseInt(get(args, "blocks", "16"));
+    mThreads = Integer.parseInt(get(args, "threads", "16"));
+    mOps = Integer.parseInt(get(args, "ops", "100000"));
+    String[] mix = get(args, "mix", "list:40,query:15,tree:5,block:30,set:10").split(",");
+    mMixOps = new String[mix.length];
+    mMixWeights = new int[mix.length];
+    for (int i = 0; i < mix.length; i++) {
+      String[] pair = mix[i].split(":");
+      mMixOps[i] = pair[0];
+      mMixWeights[i] = Integer.parseInt(pair[1]);
+    }
+  }
+
+  private static String get(Map<String, String> args, String key, String defaultValue) {
+    return args.containsKey(key) ? args.get(key) : defaultValue;
+  }
+
+  /**
+   * Formats the journal folder and starts a primary master on it.
+   */
+  private void startMaster() throws Exception {
+    checkTemporary(new File(mJournalFolder));
+    Configuration.set(PropertyKey.MASTER_JOURNAL_FOLDER, mJournalFolder);
+    Configuration.set(PropertyKey.SECURITY_AUTHORIZATION_PERMISSION_ENABLED, "false");
+    new File(mJournalFolder).mkdirs();
+    Format.format(Format.Mode.MASTER);
+    mRegistry = new MasterRegistry();
+    mJournalSystem = new JournalSystem.Builder().setLocation(new URI(mJournalFolder)).build();
+    mBlockMaster = new BlockMasterFactory().create(mRegistry, mJournalSystem);
+    mFileSystemMaster = (DefaultFileSystemMaster) new FileSystemMasterFactory()
+        .create(mRegistry, mJournalSystem);
+    mJournalSystem.start();
+    mJournalSystem.gainPrimacy();
+    mRegistry.start(true);
+  }
+
+  /**
+   * Refuses journal folders outside the temporary directory, since {@link Format} wipes them.
+   */
+  private static void checkTemporary(File folder) throws IOException {
+    File tmp = new File(System.getProperty("java.io.tmpdir")).getCanonicalFile();
+    File parent = folder.getCanonicalFile().getParentFile();
+    while (parent != null && !parent.equals(tmp)) {
+      parent = parent.getParentFile();
+    }
+    if (parent == null) {
+      throw new IllegalArgumentException("The journal folder " + folder
+          + " is formatted by the benchmark and must be below " + tmp);
+    }
+  }
+
+  private void stopMaster() throws Exception {
+    mRegistry.stop();
+    mJournalSystem.stop();
+  }
+
+  /**
+   * Creates depth levels of fanout directories with files in every leaf directory. Each file gets
+   * keys UDM pairs drawn from cardinality values and blocks index entries for {@link #VAR_NAME}.
+   */
+  private void populate() throws Exception {
+    Random random = new Random(0);
+    List<AlluxioURI> level = Collections.singletonList(new AlluxioURI("/bench"));
+    mFileSystemMaster.createDirectory(level.get(0), CreateDirectoryOptions.defaults());
+    mAllDirs.add(level.get(0));
+    for (int d = 0; d < mDepth; d++) {
+      List<AlluxioURI> next = new ArrayList<>();
+      for (AlluxioURI parent : level) {
+        for (int f = 0; f < mFanout; f++) {
+          AlluxioURI dir = parent.join("d" + f);
+          mFileSystemMaster.createDirectory(dir, CreateDirectoryOptions.defaults());
+          next.add(dir);
+        }
+      }
+      mAllDirs.addAll(next);
+      level = next;
+    }
+    mLeafDirs.addAll(level);
+    for (AlluxioURI dir : mLeafDirs) {
+      for (int f = 0; f < mFilesPerDir; f++) {
+        AlluxioURI file = dir.join("f" + f);
+        mFileSystemMaster.createFile(file,
+            CreateFileOptions.defaults().setBlockSizeBytes(BLOCK_SIZE));
+        List<Long> blockIds = new ArrayList<>();
+        for (int b = 0; b < mBlocksPerFile; b++) {
+          long blockId = mFileSystemMaster.getNewBlockIdForFile(file);
+          // There are no workers, so commit the blocks as if they were loaded from the UFS
+          mBlockMaster.commitBlockInUFS(blockId, BLOCK_SIZE);
+          blockIds.add(blockId);
+        }
+        mFileSystemMaster.completeFile(file,
+            CompleteFileOptions.defaults().setUfsLength(BLOCK_SIZE * mBlocksPerFile));
+        addBlockIndex(blockIds, random);
+        mFileSystemMaster.setAttribute(file,
+            SetAttributeOptions.defaults().setUDM(randomUDM(random)));
+        mFiles.add(file);
+      }
+    }
+  }
+
+  private void addBlockIndex(List<Long> blockIds, Random random) {
+    if (blockIds.isEmpty()) {
+      return;
+    }
+    List<Double> maxlist = new ArrayList<>();
+    List<Double> minlist = new ArrayList<>();
+    List<String> varlist = new ArrayList<>();
+    List<Long> auglist = new ArrayList<>();
+    for (int b = 0; b < blockIds.size(); b++) {
+      double min = b * 100 + random.nextInt(50);
+      minlist.add(min);
+      maxlist.add(min + 50 + random.nextInt(50));
+      varlist.add(VAR_NAME);
+      auglist.add(random.nextLong());
+    }
+    mFileSystemMaster.addBlockIndexInternal(blockIds, maxlist, minlist, varlist, auglist);
+  }
+
+  private HashMap<String, String> randomUDM(Random random) {
+    HashMap<String, String> udm = new HashMap<>();
+    for (int k = 0; k < mKeysPerFile; k++) {
+      udm.put("k" + k, Integer.toString(random.nextInt(mCardinality)));
+    }
+    return udm;
+  }
+
+  /**
+   * Runs a UDM query on a directory and on every returned directory below it, as a client
+   * searching the whole tree does.
+   *
+   * @return the number of matching files
+   */
+  private int queryTree(AlluxioURI dir, List<String> keylist, List<String> valuelist)
+      throws Exception {
+    int matches = 0;
+    for (FileInfo info : mFileSystemMaster.queryStatus(dir, keylist, valuelist)) {
+      if (info.isFolder()) {
+        matches += queryTree(new AlluxioURI(info.getPath()), keylist, valuelist);
+      } else {
+        matches++;
+      }
+    }
+    return matches;
+  }
+
+  /**
+   * Runs one operation of the given type and returns its latency in nanoseconds.
+   */
+  private long runOp(String op, Random random) throws Exception {
+    long start = System.nanoTime();
+    List<String> keylist = Collections.singletonList("k" + random.nextInt(mKeysPerFile));
+    List<String> valuelist =
+        Collections.singletonList(Integer.toString(random.nextInt(mCardinality)));
+    switch (op) {
+      case OP_LIST:
+        mFileSystemMaster.queryStatus(mLeafDirs.get(random.nextInt(mLeafDirs.size())), keylist,
+            valuelist);
+        break;
+      case OP_QUERY:
+        mFileSystemMaster.queryStatus(mAllDirs.get(random.nextInt(mAllDirs.size())), keylist,
+            valuelist);
+        break;
+      case OP_TREE:
+        queryTree(mAllDirs.get(0), keylist, valuelist);
+        break;
+      case OP_BLOCK:
+        double min = random.nextInt(100 * Math.max(mBlocksPerFile, 1));
+        mFileSystemMaster.queryFileBlockIdList(mFiles.get(random.nextInt(mFiles.size())),
+            VAR_NAME, min + 100, min, random.nextBoolean());
+        break;
+      case OP_SET:
+        mFileSystemMaster.setAttribute(mFiles.get(random.nextInt(mFiles.size())),
+            SetAttributeOptions.defaults().setUDM(randomUDM(random)));
+        break;
+      default:
+        throw new IllegalArgumentException("Unknown operation " + op);
+    }
+    return System.nanoTime() - start;
+  }
+
+  private int pickOp(Random random) {
+    int total = 0;
+    for (int weight : mMixWeights) {
+      total += weight;
+    }
+    int r = random.nextInt(total);
+    for (int i = 0; i < mMixOps.length; i++) {
+      r -= mMixWeights[i];
+      if (r < 0) {
+        return i;
+      }
+    }
+    return mMixOps.length - 1;
+  }
+
+  /**
+   * Runs the operation mix from all client threads and prints the per-operation results.
+   */
+  private void runMix() throws Exception {
+    final String user = System.getProperty("user.name");
+    final int opsPerThread = mOps / mThreads;
+    // The i-th op of thread t has type ops[t][i] and latency latencies[t][i], so the client
+    // threads never contend on the recording
+    final int[][] ops = new int[mThreads][opsPerThread];
+    final long[][] latencies = new long[mThreads][opsPerThread];
+    ExecutorService service = Executors.newFixedThreadPool(mThreads);
+    List<Future<Void>> futures = new ArrayList<>();
+    // Journal writes go to the EntryStore of the master, the log files stay empty
+    Counter journalCounter =
+        UfsJournal.getEntryStoreBytesCounter(Constants.FILE_SYSTEM_MASTER_NAME);
+    long journalBytesBefore = journalCounter.getCount();
+    long start = System.nanoTime();
+    for (int t = 0; t < mThreads; t++) {
+      final int thread = t;
+      futures.add(service.submit(new Callable<Void>() {
+        @Override
+        public Void call() throws Exception {
+          AuthenticatedClientUser.set(user);
+          Random random = new Random(thread + 1);
+          for (int i = 0; i < opsPerThread; i++) {
+            ops[thread][i] = pickOp(random);
+            latencies[thread][i] = runOp(mMixOps[ops[thread][i]], random);
+          }
+          return null;
+        }
+      }));
+    }
+    for (Future<Void> future : futures) {
+      future.get();
+    }
+    long elapsedNs = System.nanoTime() - start;
+    service.shutdown();
+    long journalBytes = journalCounter.getCount() - journalBytesBefore;
+
+    System.out.printf("Total: %d ops in %.2f s, %.1f ops/s%n", opsPerThread * mThreads,
+        elapsedNs / 1e9, opsPerThread * mThreads / (elapsedNs / 1e9));
+    int mutations = 0;
+    for (int i = 0; i < mMixOps.length; i++) {
+      long[] sorted = merge(ops, latencies, i);
+      if (mMixOps[i].equals(OP_SET)) {
+        mutations += sorted.length;
+      }
+      if (sorted.length == 0) {
+        continue;
+      }
+      String op = mMixOps[i];
+      System.out.printf("%-6s ops=%-8d ops/s=%-10.1f p50=%-8.1f p90=%-8.1f p99=%-8.1f "
+          + "p99.9=%-8.1f max=%.1f (us)%n", op, sorted.length, sorted.length / (elapsedNs / 1e9),
+          percentile(sorted, 0.5), percentile(sorted, 0.9), percentile(sorted, 0.99),
+          percentile(sorted, 0.999), sorted[sorted.length - 1] / 1e3);
+    }
+    System.out.printf("Journal bytes: %d total, %.1f per mutation%n", journalBytes,
+        mutations == 0 ? 0.0 : (double) journalBytes / mutations);
+    if (mutations > 0 && journalBytes == 0) {
+      throw new IllegalStateException(
+          "No journal bytes were counted for " + mutations + " mutations");
+    }
+  }
+
+  /**
+   * @return the latencies of one op type from all threads, sorted
+   */
+  private static long[] merge(int[][] ops, long[][] latencies, int op) {
+    int total = 0;
+    for (int[] threadOps : ops) {
+      for (int threadOp : threadOps) {
+        total += threadOp == op ? 1 : 0;
+      }
+    }
+    long[] array = new long[total];
+    int n = 0;
+    for (int t = 0; t < ops.length; t++) {
+      for (int i = 0; i < ops[t].length; i++) {
+        if (ops[t][i] == op) {
+          array[n++] = latencies[t][i];
+        }
+      }
+    }
+    Arrays.sort(array);
+    return array;
+  }
+
+  /**
+   * @return the given percentile of the sorted latencies, in microseconds
+   */
+  private static double percentile(long[] sorted, double p) {
+    int index = (int) Math.min(sorted.length - 1, Math.ceil(p * sorted.length) - 1);
+    return sorted[Math.max(index, 0)] / 1e3;
+  }
+
+  private static long usedHeap() {
+    Runtime runtime = Runtime.getRuntime();
+    for (int i = 0; i < 3; i++) {
+      System.gc();
+    }
+    return runtime.totalMemory() - runtime.freeMemory();
+  }
+
+  /**
+   * Runs the benchmark.
+   *
+   * @param args key=value parameters, see the class comment
+   */
+  public static void main(String[] args) throws Exception {
+    Map<String, String> params = new HashMap<>();
+    for (String arg : args) {
+      int split = arg.indexOf('=');
+      if (split <= 0) {
+        System.err.println("Ignoring malformed argument " + arg);
+        continue;
+      }
+      params.put(arg.substring(0, split), arg.substring(split + 1));
+    }
+    FileSystemMasterBenchmark bench = new FileSystemMasterBenchmark(params);
+    AuthenticatedClientUser.set(System.getProperty("user.name"));
+    bench.startMaster();
+    try {
+      long heapBefore = usedHeap();
+      long start = System.nanoTime();
+      bench.populate();
+      long elapsedNs = System.nanoTime() - start;
+      long heapAfter = usedHeap();
+      long inodes = bench.mAllDirs.size() + bench.mFiles.size();
+      System.out.printf("Populated %d directories and %d files in %.2f s%n",
+          bench.mAllDirs.size(), bench.mFiles.size(), elapsedNs / 1e9);
+      System.out.printf("Heap used: %d bytes total, %.1f per inode%n", heapAfter - heapBefore,
+          (double) (heapAfter - heapBefore) / inodes);
+      bench.runMix();
+    } finally {
+      bench.stopMaster();
+    }
+  }
+}
@@ -0,0 +1,273 @@
+/*
+ * The Alluxio Open Foundation licenses this work under the Apache License, version 2.0
+ * (the "License"). You may not use this work except in compliance with the License, which is
+ * available at www.apache.org/licenses/LICENSE-2.0
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied, as more fully set forth in the License.
+ *
+ * See the NOTICE file distributed with this work for information regarding copyright ownership.
+ */
+
+package alluxio.master.file.meta;
+
+import java.util.ArrayList;
+import java.util.Collection;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.TreeMap;
+
+import javax.annotation.Nullable;
+import javax.annotation.concurrent.ThreadSafe;
+
+/**
+ * The groups and datasets inside an HDF5 file, built from the records the extractor sends with
+ * the UDM of the file. A record has the key {@code h5:<object path>#<attribute>}, e.g.
+ * {@code h5:/group/IntArray#Temperature}. Layout facts of a dataset use the reserved attribute
+ * names {@link #DTYPE}, {@link #SHAPE}, {@link #CHUNK} and {@link #STORAGE_SIZE}; a dataset is
+ * any object with a {@link #DTYPE} record. Groups without records of their own are implied by
+ * the paths of their members.
+ *
+ * Records are kept only here, not in the UDM of the file, so {@link #toRecords()} is what gets
+ * journaled and checkpointed for them. The subtree summaries of the directories above the file
+ * count the attributes of each dataset, see {@link #getDatasetAttributes(Collection)}.
+ * Object paths are relative to the file, so the projection stays valid when the file is renamed.
+ */
+@ThreadSafe
+public final class HDF5Projection {
+  /** Prefix of the UDM keys which hold HDF5 object records. */
+  public static final String RECORD_PREFIX = "h5:";
+  /** Separator between the object path and the attribute name of a record key. */
+  public static final char ATTRIBUTE_SEPARATOR = '#';
+  /** Datatype class of a dataset, e.g. H5T_INTEGER. */
+  public static final String DTYPE = "h5.dtype";
+  /** Dimensions of a dataset, joined by 'x'. */
+  public static final String SHAPE = "h5.shape";
+  /** Chunk dimensions of a chunked dataset, joined by 'x'. */
+  public static final String CHUNK = "h5.chunk";
+  /** Bytes of a dataset currently written in the file. */
+  public static final String STORAGE_SIZE = "h5.storage";
+
+  /** Object path to its attributes, including implied groups with no attributes. */
+  private final TreeMap<String, HashMap<String, String>> mObjects = new TreeMap<>();
+
+  /**
+   * Creates an empty projection.
+   */
+  public HDF5Projection() {}
+
+  /**
+   * @param udmKey a UDM key
+   * @return whether the key is an HDF5 object record
+   */
+  public static boolean isRecord(String udmKey) {
+    return udmKey.startsWith(RECORD_PREFIX)
+        && udmKey.lastIndexOf(ATTRIBUTE_SEPARATOR) > RECORD_PREFIX.length();
+  }
+
+  /**
+   * @param udmKey a record key, see {@link #isRecord(String)}
+   * @return the path of the object the record belongs to
+   */
+  public static String getObjectPath(String udmKey) {
+    return normalize(
+        udmKey.substring(RECORD_PREFIX.length(), udmKey.lastIndexOf(ATTRIBUTE_SEPARATOR)));
+  }
+
+  /**
+   * Adds or replaces a record.
+   *
+   * @param udmKey the record key, see {@link #isRecord(String)}
+   * @param value the attribute value
+   */
+  public synchronized void put(String udmKey, String value) {
+    int separator = udmKey.lastIndexOf(ATTRIBUTE_SEPARATOR);
+    String objectPath = normalize(udmKey.substring(RECORD_PREFIX.length(), separator));
+    addObject(objectPath).put(udmKey.substring(separator + 1), value);
+  }
+
+  /**
+   * Removes a record, and the objects which are left without records or members.
+   *
+   * @param udmKey the record key, see {@link #isRecord(String)}
+   */
+  public synchronized void remove(String udmKey) {
+    int separator = udmKey.lastIndexOf(ATTRIBUTE_SEPARATOR);
+    String objectPath = normalize(udmKey.substring(RECORD_PREFIX.length(), separator));
+    HashMap<String, String> attributes = mObjects.get(objectPath);
+    if (attributes == null || attributes.remove(udmKey.substring(separator + 1)) == null) {
+      return;
+    }
+    while (attributes != null && attributes.isEmpty() && getChildren(objectPath).isEmpty()) {
+      mObjects.remove(objectPath);
+      int parentEnd = objectPath.lastIndexOf('/');
+      if (parentEnd <= 0) {
+        break;
+      }
+      objectPath = objectPath.substring(0, parentEnd);
+      attributes = mObjects.get(objectPath);
+    }
+  }
+
+  /**
+   * @return whether the projection holds no objects
+   */
+  public synchronized boolean isEmpty() {
+    return mObjects.isEmpty();
+  }
+
+  /**
+   * Merges the UDM of an inode with the records of its projection, as they are journaled and
+   * checkpointed together.
+   *
+   * @param udm the UDM of the inode, null if it has none
+   * @param projection the projection of the inode, null if it has none
+   * @return a new map with the UDM and every record of the projection
+   */
+  public static HashMap<String, String> withRecords(@Nullable Map<String, String> udm,
+      @Nullable HDF5Projection projection) {
+    HashMap<String, String> merged = new HashMap<>();
+    if (udm != null) {
+      merged.putAll(udm);
+    }
+    if (projection != null) {
+      merged.putAll(projection.toRecords());
+    }
+    return merged;
+  }
+
+  /**
+   * @return every record of the projection, keyed as the extractor sends them
+   */
+  public synchronized HashMap<String, String> toRecords() {
+    HashMap<String, String> records = new HashMap<>();
+    for (Map.Entry<String, HashMap<String, String>> object : mObjects.entrySet()) {
+      for (Map.Entry<String, String> attribute : object.getValue().entrySet()) {
+        records.put(RECORD_PREFIX + object.getKey() + ATTRIBUTE_SEPARATOR + attribute.getKey(),
+            attribute.getValue());
+      }
+    }
+    return records;
+  }
+
+  /**
+   * @param objectPath the path of an object inside the file
+   * @return whether the object is a group or dataset of the file
+   */
+  public synchronized boolean contains(String objectPath) {
+    return mObjects.containsKey(normalize(objectPath));
+  }
+
+  /**
+   * @param objectPath the path of an object inside the file
+   * @return whether the object is a dataset
+   */
+  public synchronized boolean isDataset(String objectPath) {
+    Map<String, String> attributes = mObjects.get(normalize(objectPath));
+    return attributes != null && attributes.containsKey(DTYPE);
+  }
+
+  /**
+   * @param objectPath the path of an object inside the file
+   * @return a copy of the attributes of the object, or null if it does not exist
+   */
+  @Nullable
+  public synchronized HashMap<String, String> getAttributes(String objectPath) {
+    HashMap<String, String> attributes = mObjects.get(normalize(objectPath));
+    return attributes == null ? null : new HashMap<>(attributes);
+  }
+
+  /**
+   * @param objectPath the path of a group inside the file, "/" for the root group
+   * @return the paths of the direct members of the group
+   */
+  public synchronized List<String> getChildren(String objectPath) {
+    String prefix = normalize(objectPath);
+    if (!prefix.endsWith("/")) {
+      prefix = prefix + "/";
+    }
+    List<String> children = new ArrayList<>();
+    for (String path : mObjects.tailMap(prefix, false).keySet()) {
+      if (!path.startsWith(prefix)) {
+        break;
+      }
+      if (path.indexOf('/', prefix.length()) < 0) {
+        children.add(path);
+      }
+    }
+    return children;
+  }
+
+  /**
+   * @param objectPath the path of an object inside the file, "/" for the file itself
+   * @return the paths a listing of the object shows: the dataset itself, or the direct members
+   *         of a group
+   */
+  public synchronized List<String> list(String objectPath) {
+    if (isDataset(objectPath)) {
+      List<String> dataset = new ArrayList<>();
+      dataset.add(normalize(objectPath));
+      return dataset;
+    }
+    return getChildren(objectPath);
+  }
+
+  /**
+   * @return the paths of all datasets in the file
+   */
+  public synchronized List<String> getDatasets() {
+    List<String> datasets = new ArrayList<>();
+    for (Map.Entry<String, HashMap<String, String>> object : mObjects.entrySet()) {
+      if (object.getValue().containsKey(DTYPE)) {
+        datasets.add(object.getKey());
+      }
+    }
+    return datasets;
+  }
+
+  /**
+   * @param objectPaths paths of objects inside the file
+   * @return a copy of the attributes of every dataset among the objects
+   */
+  public synchronized List<Map<String, String>> getDatasetAttributes(
+      Collection<String> objectPaths) {
+    List<Map<String, String>> datasets = new ArrayList<>();
+    for (String objectPath : objectPaths) {
+      HashMap<String, String> attributes = mObjects.get(normalize(objectPath));
+      if (attributes != null && attributes.containsKey(DTYPE)) {
+        datasets.add(new HashMap<>(attributes));
+      }
+    }
+    return datasets;
+  }
+
+  /**
+   * @return a copy of the attributes of every dataset in the file
+   */
+  public synchronized List<Map<String, String>> getDatasetAttributes() {
+    return getDatasetAttributes(mObjects.keySet());
+  }
+
+  private HashMap<String, String> addObject(String objectPath) {
+    HashMap<String, String> attributes = mObjects.get(objectPath);
+    if (attributes == null) {
+      attributes = new HashMap<>();
+      mObjects.put(objectPath, attributes);
+      // Add the implied ancestor groups, the root group is the file itself
+      int parentEnd = objectPath.lastIndexOf('/');
+      if (parentEnd > 0) {
+        addObject(objectPath.substring(0, parentEnd));
+      }
+    }
+    return attributes;
+  }
+
+  private static String normalize(String objectPath) {
+    String path = objectPath.startsWith("/") ? objectPath : "/" + objectPath;
+    while (path.length() > 1 && path.endsWith("/")) {
+      path = path.substring(0, path.length() - 1);
+    }
+    return path;
+  }
+}
@@ -0,0 +1,139 @@
+/*
+ * The Alluxio Open Foundation licenses this work under the Apache License, version 2.0
+ * (the "License"). You may not use this work except in compliance with the License, which is
+ * available at www.apache.org/licenses/LICENSE-2.0
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied, as more fully set forth in the License.
+ *
+ * See the NOTICE file distributed with this work for information regarding copyright ownership.
+ */
+
+package alluxio.master.file.meta;
+
+import org.junit.Assert;
+import org.junit.Test;
+
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.HashMap;
+import java.util.Map;
+
+/**
+ * Unit tests for {@link HDF5Projection}.
+ */
+public final class HDF5ProjectionTest {
+  /**
+   * Tests which keys are HDF5 object records.
+   */
+  @Test
+  public void isRecord() {
+    Assert.assertTrue(HDF5Projection.isRecord("h5:/group/data#Temperature"));
+    Assert.assertTrue(HDF5Projection.isRecord("h5:/#owner"));
+    Assert.assertFalse(HDF5Projection.isRecord("Temperature"));
+    Assert.assertFalse(HDF5Projection.isRecord("h5:#owner"));
+    Assert.assertFalse(HDF5Projection.isRecord("h5:/group/data"));
+  }
+
+  /**
+   * Tests that records build the object tree and come back unchanged.
+   */
+  @Test
+  public void putAndToRecords() {
+    HDF5Projection projection = new HDF5Projection();
+    Assert.assertTrue(projection.isEmpty());
+    Map<String, String> records = new HashMap<>();
+    records.put("h5:/group/data#" + HDF5Projection.DTYPE, "H5T_FLOAT");
+    records.put("h5:/group/data#Temperature", "273.15");
+    records.put("h5:/group#owner", "Peng");
+    records.put("h5:/a/b/c#" + HDF5Projection.DTYPE, "H5T_INTEGER");
+    for (Map.Entry<String, String> record : records.entrySet()) {
+      projection.put(record.getKey(), record.getValue());
+    }
+    Assert.assertEquals(records, projection.toRecords());
+    Assert.assertTrue(projection.isDataset("/group/data"));
+    Assert.assertFalse(projection.isDataset("/group"));
+    Assert.assertTrue(projection.contains("/a/b"));
+    Assert.assertEquals(Arrays.asList("/a", "/group"), projection.getChildren("/"));
+    Assert.assertEquals(Arrays.asList("/a/b/c", "/group/data"), projection.getDatasets());
+    Assert.assertEquals("273.15", projection.getAttributes("/group/data").get("Temperature"));
+  }
+
+  /**
+   * Tests the attributes of datasets, which the subtree summaries count.
+   */
+  @Test
+  public void getDatasetAttributes() {
+    HDF5Projection projection = new HDF5Projection();
+    projection.put("h5:/group#owner", "Peng");
+    projection.put("h5:/group/data#" + HDF5Projection.DTYPE, "H5T_FLOAT");
+    projection.put("h5:/group/data#Temperature", "273.15");
+    Assert.assertEquals("/group/data",
+        HDF5Projection.getObjectPath("h5:/group/data#Temperature"));
+    Assert.assertEquals("/", HDF5Projection.getObjectPath("h5:/#owner"));
+
+    Map<String, String> data = new HashMap<>();
+    data.put(HDF5Projection.DTYPE, "H5T_FLOAT");
+    data.put("Temperature", "273.15");
+    Assert.assertEquals(Arrays.asList(data), projection.getDatasetAttributes());
+    Assert.assertEquals(Arrays.asList(data),
+        projection.getDatasetAttributes(Arrays.asList("/group", "group/data", "/missing")));
+    Assert.assertTrue(projection.getDatasetAttributes(Arrays.asList("/group")).isEmpty());
+  }
+
+  /**
+   * Tests that listing the file itself shows the members of the root group, and that listing a
+   * dataset shows the dataset.
+   */
+  @Test
+  public void list() {
+    HDF5Projection projection = new HDF5Projection();
+    projection.put("h5:/#owner", "Peng");
+    projection.put("h5:/IntArray#" + HDF5Projection.DTYPE, "H5T_INTEGER");
+    projection.put("h5:/group/data#" + HDF5Projection.DTYPE, "H5T_FLOAT");
+    Assert.assertEquals(Arrays.asList("/IntArray", "/group"), projection.list("/"));
+    Assert.assertEquals(Arrays.asList("/IntArray", "/group"), projection.list(""));
+    Assert.assertEquals(Arrays.asList("/group/data"), projection.list("/group"));
+    Assert.assertEquals(Arrays.asList("/group/data"), projection.list("/group/data"));
+  }
+
+  /**
+   * Tests that records are journaled for a file which has no UDM, as when the extractor only
+   * projects a freshly created file.
+   */
+  @Test
+  public void withRecordsWithoutUDM() {
+    HDF5Projection projection = new HDF5Projection();
+    projection.put("h5:/group/data#" + HDF5Projection.DTYPE, "H5T_FLOAT");
+    Assert.assertEquals(projection.toRecords(), HDF5Projection.withRecords(null, projection));
+    Assert.assertTrue(HDF5Projection.withRecords(null, null).isEmpty());
+
+    Map<String, String> udm = new HashMap<>();
+    udm.put("owner", "Peng");
+    Map<String, String> merged = HDF5Projection.withRecords(udm, projection);
+    Assert.assertEquals(2, merged.size());
+    Assert.assertEquals("Peng", merged.get("owner"));
+    Assert.assertEquals("H5T_FLOAT", merged.get("h5:/group/data#" + HDF5Projection.DTYPE));
+  }
+
+  /**
+   * Tests that removing the last record of an object removes it and its empty groups.
+   */
+  @Test
+  public void remove() {
+    HDF5Projection projection = new HDF5Projection();
+    projection.put("h5:/a/b/c#" + HDF5Projection.DTYPE, "H5T_INTEGER");
+    projection.put("h5:/a#owner", "Peng");
+    projection.remove("h5:/a/b/c#missing");
+    Assert.assertTrue(projection.contains("/a/b/c"));
+
+    projection.remove("h5:/a/b/c#" + HDF5Projection.DTYPE);
+    Assert.assertFalse(projection.contains("/a/b/c"));
+    Assert.assertFalse(projection.contains("/a/b"));
+    Assert.assertTrue(projection.contains("/a"));
+    Assert.assertEquals(Collections.<String>emptyList(), projection.getChildren("/a"));
+
+    projection.remove("h5:/a#owner");
+    Assert.assertTrue(projection.isEmpty());
+  }
+}
@@ -0,0 +1,393 @@
+/*
+ * The Alluxio Open Foundation licenses this work under the Apache License, version 2.0
+ * (the "License"). You may not use this work except in compliance with the License, which is
+ * available at www.apache.org/licenses/LICENSE-2.0
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied, as more fully set forth in the License.
+ *
+ * See the NOTICE file distributed with this work for information regarding copyright ownership.
+ */
+
+package alluxio.master.file.meta;
+
+import com.google.common.annotations.VisibleForTesting;
+import com.google.common.base.Charsets;
+
+import java.io.Closeable;
+import java.io.File;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.nio.BufferUnderflowException;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+
+import javax.annotation.Nullable;
+import javax.annotation.concurrent.NotThreadSafe;
+
+/**
+ * Flat image of the user-defined metadata (UDM) of all inodes, written with each journal
+ * checkpoint. Journal checkpoints do not carry UDM, and replaying it from Java-serialized
+ * {@code SetAttributeEntry} blobs dominates master startup, so the image is memory-mapped and an
+ * inode's UDM is decoded only when that inode is replayed. An image is stamped with the sequence
+ * number of its checkpoint and is only used to replay that checkpoint.
+ *
+ * Version 2 layout, all sections contiguous and big-endian, every long 8-byte aligned:
+ * <pre>
+ *   int magic, int version, long checkpoint sequence number,
+ *   int numStrings, int numInodes, int numPairs, int padding
+ *   long[numInodes]      inode ids, sorted
+ *   long[numStrings + 1] byte offset of each dictionary string
+ *   int[numInodes + 1]   offset of the first pair of each inode
+ *   int[numPairs]        key of each pair, as a dictionary index
+ *   int[numPairs]        value of each pair, as a dictionary index
+ *   byte[]               UTF-8 dictionary strings
+ * </pre>
+ * Keys and values are shared through the dictionary, so each distinct string is stored and
+ * decoded once. The file is mapped in fixed-size chunks addressed by long offsets, so an image
+ * may exceed the 2 GiB limit of a single mapping.
+ */
+@NotThreadSafe
+public final class UDMImage implements Closeable {
+  private static final int MAGIC = 0x55444D49;
+  private static final int VERSION = 2;
+  private static final int HEADER_BYTES = 32;
+  /** Size of each mapping, a multiple of 8 so no int or long crosses two chunks. */
+  private static final int CHUNK_BYTES = 1 << 30;
+
+  private final RandomAccessFile mFile;
+  private final Chunks mChunks;
+  private final long mCheckpointSequenceNumber;
+  private final int mNumStrings;
+  private final int mNumInodes;
+  private final int mNumPairs;
+  private final long mInodeIdsOffset;
+  private final long mStringOffsetsOffset;
+  private final long mPairOffsetsOffset;
+  private final long mKeysOffset;
+  private final long mValuesOffset;
+  private final long mStringDataOffset;
+  /** Dictionary strings decoded so far. */
+  private final String[] mStrings;
+
+  private UDMImage(RandomAccessFile file, Chunks chunks, long length) throws IOException {
+    mFile = file;
+    mChunks = chunks;
+    if (length < HEADER_BYTES || chunks.getInt(0) != MAGIC) {
+      throw new IOException("Not a UDM image");
+    }
+    if (chunks.getInt(4) != VERSION) {
+      throw new IOException("Unsupported UDM image version " + chunks.getInt(4));
+    }
+    mCheckpointSequenceNumber = chunks.getLong(8);
+    mNumStrings = chunks.getInt(16);
+    mNumInodes = chunks.getInt(20);
+    mNumPairs = chunks.getInt(24);
+    if (mNumStrings < 0 || mNumInodes < 0 || mNumPairs < 0) {
+      throw new IOException("Corrupt UDM image header");
+    }
+    mInodeIdsOffset = HEADER_BYTES;
+    mStringOffsetsOffset = mInodeIdsOffset + 8L * mNumInodes;
+    mPairOffsetsOffset = mStringOffsetsOffset + 8L * (mNumStrings + 1);
+    mKeysOffset = mPairOffsetsOffset + 4L * (mNumInodes + 1);
+    mValuesOffset = mKeysOffset + 4L * mNumPairs;
+    mStringDataOffset = mValuesOffset + 4L * mNumPairs;
+    if (mStringDataOffset > length
+        || mStringDataOffset + chunks.getLong(mPairOffsetsOffset - 8) != length) {
+      throw new IOException("UDM image of " + length + " bytes is truncated or corrupt");
+    }
+    mStrings = new String[mNumStrings];
+  }
+
+  /**
+   * Maps an image file.
+   *
+   * @param file the image file
+   * @return the image, or null if the file does not exist
+   * @throws IOException if the file cannot be mapped, is truncated or has an unsupported format
+   */
+  @Nullable
+  public static UDMImage open(File file) throws IOException {
+    return open(file, CHUNK_BYTES);
+  }
+
+  @VisibleForTesting
+  @Nullable
+  static UDMImage open(File file, int chunkBytes) throws IOException {
+    if (!file.exists()) {
+      return null;
+    }
+    RandomAccessFile raf = new RandomAccessFile(file, "r");
+    try {
+      FileChannel channel = raf.getChannel();
+      long length = channel.size();
+      return new UDMImage(raf, Chunks.map(channel, FileChannel.MapMode.READ_ONLY, length,
+          chunkBytes), length);
+    } catch (IOException | RuntimeException e) {
+      raf.close();
+      if (e instanceof IOException) {
+        throw (IOException) e;
+      }
+      throw new IOException("Failed to decode UDM image " + file, e);
+    }
+  }
+
+  /**
+   * Writes an image, replacing any previous one only once the new one is complete and synced.
+   *
+   * @param file the image file
+   * @param checkpointSequenceNumber the sequence number of the checkpoint the image belongs to
+   * @param udms inode id to the UDM of the inode, inodes without UDM may be left out
+   * @throws IOException if the image cannot be written
+   */
+  public static void write(File file, long checkpointSequenceNumber,
+      Map<Long, ? extends Map<String, String>> udms) throws IOException {
+    write(file, checkpointSequenceNumber, udms, CHUNK_BYTES);
+  }
+
+  @VisibleForTesting
+  static void write(File file, long checkpointSequenceNumber,
+      Map<Long, ? extends Map<String, String>> udms, int chunkBytes) throws IOException {
+    long[] inodeIds = new long[udms.size()];
+    int i = 0;
+    long totalPairs = 0;
+    for (Map.Entry<Long, ? extends Map<String, String>> entry : udms.entrySet()) {
+      inodeIds[i++] = entry.getKey();
+      totalPairs += entry.getValue().size();
+    }
+    if (totalPairs > Integer.MAX_VALUE - 8) {
+      throw new IOException("Too many UDM pairs for an image: " + totalPairs);
+    }
+    int numPairs = (int) totalPairs;
+    Arrays.sort(inodeIds);
+
+    Map<String, Integer> dictionary = new HashMap<>();
+    List<byte[]> strings = new ArrayList<>();
+    int[] pairOffsets = new int[inodeIds.length + 1];
+    int[] keys = new int[numPairs];
+    int[] values = new int[numPairs];
+    int pair = 0;
+    for (i = 0; i < inodeIds.length; i++) {
+      pairOffsets[i] = pair;
+      for (Map.Entry<String, String> udm : udms.get(inodeIds[i]).entrySet()) {
+        keys[pair] = intern(udm.getKey(), dictionary, strings);
+        values[pair] = intern(udm.getValue(), dictionary, strings);
+        pair++;
+      }
+    }
+    pairOffsets[inodeIds.length] = pair;
+    long[] stringOffsets = new long[strings.size() + 1];
+    for (i = 0; i < strings.size(); i++) {
+      stringOffsets[i + 1] = stringOffsets[i] + strings.get(i).length;
+    }
+
+    long size = HEADER_BYTES + 8L * inodeIds.length + 8L * stringOffsets.length
+        + 4L * pairOffsets.length + 8L * numPairs + stringOffsets[strings.size()];
+    File tmp = new File(file.getPath() + ".tmp");
+    try (RandomAccessFile raf = new RandomAccessFile(tmp, "rw");
+         FileChannel channel = raf.getChannel()) {
+      raf.setLength(size);
+      Chunks chunks = Chunks.map(channel, FileChannel.MapMode.READ_WRITE, size, chunkBytes);
+      chunks.putInt(0, MAGIC);
+      chunks.putInt(4, VERSION);
+      chunks.putLong(8, checkpointSequenceNumber);
+      chunks.putInt(16, strings.size());
+      chunks.putInt(20, inodeIds.length);
+      chunks.putInt(24, numPairs);
+      long offset = HEADER_BYTES;
+      for (long inodeId : inodeIds) {
+        chunks.putLong(offset, inodeId);
+        offset += 8;
+      }
+      for (long stringOffset : stringOffsets) {
+        chunks.putLong(offset, stringOffset);
+        offset += 8;
+      }
+      for (int pairOffset : pairOffsets) {
+        chunks.putInt(offset, pairOffset);
+        offset += 4;
+      }
+      for (int key : keys) {
+        chunks.putInt(offset, key);
+        offset += 4;
+      }
+      for (int value : values) {
+        chunks.putInt(offset, value);
+        offset += 4;
+      }
+      for (byte[] string : strings) {
+        chunks.put(offset, string);
+        offset += string.length;
+      }
+      chunks.force();
+    }
+    if (!tmp.renameTo(file)) {
+      if (!file.delete() || !tmp.renameTo(file)) {
+        throw new IOException("Failed to replace UDM image " + file);
+      }
+    }
+  }
+
+  /**
+   * @return the sequence number of the checkpoint the image was written with
+   */
+  public long getCheckpointSequenceNumber() {
+    return mCheckpointSequenceNumber;
+  }
+
+  /**
+   * @param inodeId the id of an inode
+   * @return the UDM of the inode, or null if the image holds none for it
+   * @throws IOException if the entries of the inode are corrupt
+   */
+  @Nullable
+  public HashMap<String, String> getUDM(long inodeId) throws IOException {
+    int low = 0;
+    int high = mNumInodes - 1;
+    while (low <= high) {
+      int mid = (low + high) >>> 1;
+      long id = mChunks.getLong(mInodeIdsOffset + 8L * mid);
+      if (id < inodeId) {
+        low = mid + 1;
+      } else if (id > inodeId) {
+        high = mid - 1;
+      } else {
+        int start = mChunks.getInt(mPairOffsetsOffset + 4L * mid);
+        int end = mChunks.getInt(mPairOffsetsOffset + 4L * (mid + 1));
+        if (start < 0 || start > end || end > mNumPairs) {
+          throw new IOException("Corrupt pair offsets of inode " + inodeId + " in UDM image");
+        }
+        HashMap<String, String> udm = new HashMap<>();
+        for (int pair = start; pair < end; pair++) {
+          udm.put(getString(mChunks.getInt(mKeysOffset + 4L * pair)),
+              getString(mChunks.getInt(mValuesOffset + 4L * pair)));
+        }
+        return udm;
+      }
+    }
+    return null;
+  }
+
+  @Override
+  public void close() throws IOException {
+    mFile.close();
+  }
+
+  private String getString(int index) throws IOException {
+    if (index < 0 || index >= mNumStrings) {
+      throw new IOException("Corrupt string index " + index + " in UDM image");
+    }
+    String string = mStrings[index];
+    if (string == null) {
+      long start = mChunks.getLong(mStringOffsetsOffset + 8L * index);
+      long end = mChunks.getLong(mStringOffsetsOffset + 8L * (index + 1));
+      if (start < 0 || start > end || end - start > Integer.MAX_VALUE
+          || mStringDataOffset + end > mChunks.getLength()) {
+        throw new IOException("Corrupt string offsets of string " + index + " in UDM image");
+      }
+      byte[] bytes = new byte[(int) (end - start)];
+      mChunks.get(mStringDataOffset + start, bytes);
+      string = new String(bytes, Charsets.UTF_8);
+      mStrings[index] = string;
+    }
+    return string;
+  }
+
+  private static int intern(String string, Map<String, Integer> dictionary,
+      List<byte[]> strings) {
+    Integer index = dictionary.get(string);
+    if (index == null) {
+      index = strings.size();
+      dictionary.put(string, index);
+      strings.add(string.getBytes(Charsets.UTF_8));
+    }
+    return index;
+  }
+
+  /**
+   * A file mapped as consecutive chunks of equal size, addressed by long offsets.
+   */
+  private static final class Chunks {
+    private final MappedByteBuffer[] mChunks;
+    private final int mChunkBytes;
+    private final long mLength;
+
+    private Chunks(MappedByteBuffer[] chunks, int chunkBytes, long length) {
+      mChunks = chunks;
+      mChunkBytes = chunkBytes;
+      mLength = length;
+    }
+
+    private static Chunks map(FileChannel channel, FileChannel.MapMode mode, long length,
+        int chunkBytes) throws IOException {
+      MappedByteBuffer[] chunks =
+          new MappedByteBuffer[(int) ((length + chunkBytes - 1) / chunkBytes)];
+      for (int i = 0; i < chunks.length; i++) {
+        long position = (long) i * chunkBytes;
+        chunks[i] = channel.map(mode, position, Math.min(chunkBytes, length - position));
+      }
+      return new Chunks(chunks, chunkBytes, length);
+    }
+
+    private long getLength() {
+      return mLength;
+    }
+
+    private int getInt(long offset) {
+      check(offset, 4);
+      return mChunks[(int) (offset / mChunkBytes)].getInt((int) (offset % mChunkBytes));
+    }
+
+    private long getLong(long offset) {
+      check(offset, 8);
+      return mChunks[(int) (offset / mChunkBytes)].getLong((int) (offset % mChunkBytes));
+    }
+
+    private void putInt(long offset, int value) {
+      mChunks[(int) (offset / mChunkBytes)].putInt((int) (offset % mChunkBytes), value);
+    }
+
+    private void putLong(long offset, long value) {
+      mChunks[(int) (offset / mChunkBytes)].putLong((int) (offset % mChunkBytes), value);
+    }
+
+    private void get(long offset, byte[] bytes) {
+      int done = 0;
+      while (done < bytes.length) {
+        MappedByteBuffer chunk = mChunks[(int) ((offset + done) / mChunkBytes)].duplicate();
+        chunk.position((int) ((offset + done) % mChunkBytes));
+        int length = Math.min(bytes.length - done, chunk.remaining());
+        chunk.get(bytes, done, length);
+        done += length;
+      }
+    }
+
+    private void put(long offset, byte[] bytes) {
+      int done = 0;
+      while (done < bytes.length) {
+        MappedByteBuffer chunk = mChunks[(int) ((offset + done) / mChunkBytes)].duplicate();
+        chunk.position((int) ((offset + done) % mChunkBytes));
+        int length = Math.min(bytes.length - done, chunk.remaining());
+        chunk.put(bytes, done, length);
+        done += length;
+      }
+    }
+
+    private void force() {
+      for (MappedByteBuffer chunk : mChunks) {
+        chunk.force();
+      }
+    }
+
+    private void check(long offset, int length) {
+      if (offset < 0 || offset + length > mLength) {
+        throw new BufferUnderflowException();
+      }
+    }
+  }
+}
@@ -0,0 +1,131 @@
+/*
+ * The Alluxio Open Foundation licenses this work under the Apache License, version 2.0
+ * (the "License"). You may not use this work except in compliance with the License, which is
+ * available at www.apache.org/licenses/LICENSE-2.0
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied, as more fully set forth in the License.
+ *
+ * See the NOTICE file distributed with this work for information regarding copyright ownership.
+ */
+
+package alluxio.master.file.meta;
+
+import org.junit.Assert;
+import org.junit.Rule;
+import org.junit.Test;
+import org.junit.rules.TemporaryFolder;
+
+import java.io.File;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.util.HashMap;
+import java.util.Map;
+
+/**
+ * Unit tests for {@link UDMImage}.
+ */
+public final class UDMImageTest {
+  /** Small chunks, so sections and strings cross chunk boundaries. */
+  private static final int CHUNK_BYTES = 64;
+
+  @Rule
+  public TemporaryFolder mFolder = new TemporaryFolder();
+
+  private static Map<Long, Map<String, String>> udms(int numInodes) {
+    Map<Long, Map<String, String>> udms = new HashMap<>();
+    for (long id = 0; id < numInodes; id++) {
+      Map<String, String> udm = new HashMap<>();
+      udm.put("owner", "user" + (id % 7));
+      udm.put("long-key-" + (id % 3), "a value long enough to span a chunk boundary " + id);
+      udms.put(id * 3 + 1, udm);
+    }
+    return udms;
+  }
+
+  /**
+   * Tests that the UDM of every inode is read back through chunked mappings.
+   */
+  @Test
+  public void roundTrip() throws Exception {
+    File file = new File(mFolder.getRoot(), "UDMImage");
+    Map<Long, Map<String, String>> udms = udms(500);
+    UDMImage.write(file, 42, udms, CHUNK_BYTES);
+    try (UDMImage image = UDMImage.open(file, CHUNK_BYTES)) {
+      Assert.assertEquals(42, image.getCheckpointSequenceNumber());
+      for (Map.Entry<Long, Map<String, String>> entry : udms.entrySet()) {
+        Assert.assertEquals(entry.getValue(), image.getUDM(entry.getKey()));
+      }
+      Assert.assertNull(image.getUDM(0));
+      Assert.assertNull(image.getUDM(3 * 500 + 1));
+    }
+    // The default chunk size reads the same file
+    try (UDMImage image = UDMImage.open(file)) {
+      Assert.assertEquals(udms.get(4L), image.getUDM(4));
+    }
+  }
+
+  /**
+   * Tests that an image without inodes can be written and opened.
+   */
+  @Test
+  public void empty() throws Exception {
+    File file = new File(mFolder.getRoot(), "UDMImage");
+    UDMImage.write(file, 0, new HashMap<Long, Map<String, String>>(), CHUNK_BYTES);
+    try (UDMImage image = UDMImage.open(file, CHUNK_BYTES)) {
+      Assert.assertNull(image.getUDM(1));
+    }
+    Assert.assertNull(UDMImage.open(new File(mFolder.getRoot(), "missing")));
+  }
+
+  /**
+   * Tests that a truncated image fails to open instead of being partly applied.
+   */
+  @Test
+  public void truncated() throws Exception {
+    File file = new File(mFolder.getRoot(), "UDMImage");
+    UDMImage.write(file, 7, udms(10), CHUNK_BYTES);
+    try (RandomAccessFile raf = new RandomAccessFile(file, "rw")) {
+      raf.setLength(raf.length() - 1);
+    }
+    try {
+      UDMImage.open(file, CHUNK_BYTES);
+      Assert.fail("A truncated image must not open");
+    } catch (IOException e) {
+      // expected
+    }
+    try (RandomAccessFile raf = new RandomAccessFile(file, "rw")) {
+      raf.setLength(10);
+    }
+    try {
+      UDMImage.open(file, CHUNK_BYTES);
+      Assert.fail("An image shorter than its header must not open");
+    } catch (IOException e) {
+      // expected
+    }
+  }
+
+  /**
+   * Tests that a dictionary index out of range is reported instead of read past the dictionary.
+   */
+  @Test
+  public void corruptIndex() throws Exception {
+    File file = new File(mFolder.getRoot(), "UDMImage");
+    Map<Long, Map<String, String>> udms = new HashMap<>();
+    Map<String, String> udm = new HashMap<>();
+    udm.put("k", "v");
+    udms.put(5L, udm);
+    UDMImage.write(file, 1, udms, CHUNK_BYTES);
+    try (RandomAccessFile raf = new RandomAccessFile(file, "rw")) {
+      // Header, one inode id, three string offsets and two pair offsets precede the key index
+      raf.seek(32 + 8 + 3 * 8 + 2 * 4);
+      raf.writeInt(1000);
+    }
+    try (UDMImage image = UDMImage.open(file, CHUNK_BYTES)) {
+      image.getUDM(5);
+      Assert.fail("A corrupt dictionary index must be reported");
+    } catch (IOException e) {
+      // expected
+    }
+  }
+}
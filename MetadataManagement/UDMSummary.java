@@ -0,0 +1,328 @@
+/*
+ * The Alluxio Open Foundation licenses this work under the Apache License, version 2.0
+ * (the "License"). You may not use this work except in compliance with the License, which is
+ * available at www.apache.org/licenses/LICENSE-2.0
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied, as more fully set forth in the License.
+ *
+ * See the NOTICE file distributed with this work for information regarding copyright ownership.
+ */
+
+package alluxio.master.file.meta;
+
+import com.google.common.annotations.VisibleForTesting;
+
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+
+import javax.annotation.concurrent.ThreadSafe;
+
+/**
+ * Summary of the user-defined metadata (UDM) stored under a directory. It counts a 32-bit
+ * fingerprint of every (key, value) pair of the descendant files and of the datasets projected
+ * from their HDF5 records, and keeps the min/max value of
+ * every key whose values are all numeric. The summary may report false positives but never false
+ * negatives, so a query can skip a whole subtree when {@link #mightContain(List, List)} returns
+ * false.
+ *
+ * The fingerprints live in an open-addressing table which grows and shrinks with the number of
+ * distinct pairs, so a pair which is absent from the subtree matches with a probability of about
+ * n / 2^32 for n distinct pairs, independent of the size of the subtree. Counts are exact ints,
+ * so deletes and renames can be applied incrementally. Numeric ranges are only ever widened; they
+ * are tightened again once the subtree becomes empty. A summary holds no table until its first
+ * pair is added.
+ */
+@ThreadSafe
+public final class UDMSummary {
+  /** Smallest number of slots of a non-empty table, a power of two. */
+  private static final int MIN_CAPACITY = 16;
+
+  /** Fingerprint of each slot, 0 for a free slot; null while the summary is empty. */
+  private int[] mFingerprints;
+  /** Number of pairs with the fingerprint of each slot. */
+  private int[] mCounts;
+  /** Number of occupied slots. */
+  private int mSlotsUsed = 0;
+  /** Key to {min, max}; a null range means the key has non-numeric values in the subtree. */
+  private final Map<String, double[]> mRanges = new HashMap<>();
+  /** Number of (key, value) pairs currently summarized. */
+  private long mNumPairs = 0;
+
+  /**
+   * Creates an empty summary.
+   */
+  public UDMSummary() {}
+
+  /**
+   * Adds the UDM of one file, or the attributes of one projected dataset, to the summary.
+   *
+   * @param udm the user-defined metadata to add
+   */
+  public synchronized void add(Map<String, String> udm) {
+    for (Map.Entry<String, String> pair : udm.entrySet()) {
+      adjust(fingerprint(pair.getKey(), pair.getValue()), 1);
+      updateRange(pair.getKey(), pair.getValue());
+      mNumPairs++;
+    }
+  }
+
+  /**
+   * Removes the UDM of one file from the summary. The map must have been added before.
+   *
+   * @param udm the user-defined metadata to remove
+   */
+  public synchronized void remove(Map<String, String> udm) {
+    for (Map.Entry<String, String> pair : udm.entrySet()) {
+      adjust(fingerprint(pair.getKey(), pair.getValue()), -1);
+      mNumPairs--;
+    }
+    clearIfEmpty();
+  }
+
+  /**
+   * Adds every pair summarized by another summary, e.g. when a subtree is moved in.
+   *
+   * @param other the summary to merge
+   */
+  public void merge(UDMSummary other) {
+    combine(other, 1);
+  }
+
+  /**
+   * Removes every pair summarized by another summary, e.g. when a subtree is moved out.
+   *
+   * @param other the summary to subtract
+   */
+  public void subtract(UDMSummary other) {
+    combine(other, -1);
+  }
+
+  /**
+   * @param keylist the keys of the query condition
+   * @param valuelist the values of the query condition
+   * @return false if no file in the subtree can have all the given (key, value) pairs
+   */
+  public synchronized boolean mightContain(List<String> keylist, List<String> valuelist) {
+    if (mNumPairs == 0) {
+      return false;
+    }
+    for (int i = 0; i < keylist.size(); i++) {
+      String key = keylist.get(i);
+      String value = valuelist.get(i);
+      if (find(fingerprint(key, value)) < 0) {
+        return false;
+      }
+      double[] range = mRanges.get(key);
+      if (range != null) {
+        Double number = parseNumber(value);
+        if (number != null && (number < range[0] || number > range[1])) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @return true if the summary holds no pairs
+   */
+  public synchronized boolean isEmpty() {
+    return mNumPairs == 0;
+  }
+
+  /**
+   * @return the number of slots of the fingerprint table, 0 if none is allocated
+   */
+  @VisibleForTesting
+  synchronized int getCapacity() {
+    return mFingerprints == null ? 0 : mFingerprints.length;
+  }
+
+  private void combine(UDMSummary other, int delta) {
+    if (other == this) {
+      return;
+    }
+    int[] fingerprints;
+    int[] counts;
+    Map<String, double[]> ranges;
+    long numPairs;
+    synchronized (other) {
+      fingerprints = other.mFingerprints == null ? new int[0] : other.mFingerprints.clone();
+      counts = other.mCounts == null ? new int[0] : other.mCounts.clone();
+      ranges = new HashMap<>(other.mRanges);
+      numPairs = other.mNumPairs;
+    }
+    synchronized (this) {
+      for (int i = 0; i < fingerprints.length; i++) {
+        if (fingerprints[i] != 0) {
+          adjust(fingerprints[i], delta * counts[i]);
+        }
+      }
+      mNumPairs += delta * numPairs;
+      if (delta > 0) {
+        for (Map.Entry<String, double[]> range : ranges.entrySet()) {
+          widenRange(range.getKey(), range.getValue());
+        }
+      }
+      clearIfEmpty();
+    }
+  }
+
+  /**
+   * @return the slot holding the fingerprint, or -1 if it is absent
+   */
+  private int find(int fingerprint) {
+    if (mFingerprints == null) {
+      return -1;
+    }
+    int mask = mFingerprints.length - 1;
+    for (int slot = home(fingerprint, mask); ; slot = (slot + 1) & mask) {
+      if (mFingerprints[slot] == fingerprint) {
+        return slot;
+      }
+      if (mFingerprints[slot] == 0) {
+        return -1;
+      }
+    }
+  }
+
+  private void adjust(int fingerprint, int delta) {
+    int slot = find(fingerprint);
+    if (slot >= 0) {
+      long count = (long) mCounts[slot] + delta;
+      if (count > 0) {
+        mCounts[slot] = (int) Math.min(count, Integer.MAX_VALUE);
+      } else {
+        delete(slot);
+      }
+      return;
+    }
+    if (delta <= 0) {
+      return;
+    }
+    if (mFingerprints == null || (mSlotsUsed + 1) * 2 > mFingerprints.length) {
+      resize(mFingerprints == null ? MIN_CAPACITY : mFingerprints.length * 2);
+    }
+    insert(fingerprint, delta);
+  }
+
+  private void insert(int fingerprint, int count) {
+    int mask = mFingerprints.length - 1;
+    int slot = home(fingerprint, mask);
+    while (mFingerprints[slot] != 0) {
+      slot = (slot + 1) & mask;
+    }
+    mFingerprints[slot] = fingerprint;
+    mCounts[slot] = count;
+    mSlotsUsed++;
+  }
+
+  /**
+   * Frees a slot and shifts back the entries of its probe run, so lookups stay correct without
+   * tombstones. The table shrinks once it is mostly empty.
+   */
+  private void delete(int slot) {
+    int mask = mFingerprints.length - 1;
+    int hole = slot;
+    for (int next = (hole + 1) & mask; mFingerprints[next] != 0; next = (next + 1) & mask) {
+      int home = home(mFingerprints[next], mask);
+      // Move the entry into the hole unless its home lies cyclically in (hole, next]
+      if (hole <= next ? (home <= hole || home > next) : (home <= hole && home > next)) {
+        mFingerprints[hole] = mFingerprints[next];
+        mCounts[hole] = mCounts[next];
+        hole = next;
+      }
+    }
+    mFingerprints[hole] = 0;
+    mCounts[hole] = 0;
+    mSlotsUsed--;
+    if (mFingerprints.length > MIN_CAPACITY && mSlotsUsed * 8 < mFingerprints.length) {
+      resize(mFingerprints.length / 2);
+    }
+  }
+
+  private void resize(int capacity) {
+    int[] fingerprints = mFingerprints;
+    int[] counts = mCounts;
+    mFingerprints = new int[capacity];
+    mCounts = new int[capacity];
+    mSlotsUsed = 0;
+    if (fingerprints != null) {
+      for (int i = 0; i < fingerprints.length; i++) {
+        if (fingerprints[i] != 0) {
+          insert(fingerprints[i], counts[i]);
+        }
+      }
+    }
+  }
+
+  private void updateRange(String key, String value) {
+    Double number = parseNumber(value);
+    if (number == null) {
+      mRanges.put(key, null);
+    } else {
+      widenRange(key, new double[] {number, number});
+    }
+  }
+
+  private void widenRange(String key, double[] range) {
+    if (mRanges.containsKey(key) && mRanges.get(key) == null) {
+      return;
+    }
+    if (range == null) {
+      mRanges.put(key, null);
+      return;
+    }
+    double[] current = mRanges.get(key);
+    if (current == null) {
+      mRanges.put(key, range.clone());
+    } else {
+      current[0] = Math.min(current[0], range[0]);
+      current[1] = Math.max(current[1], range[1]);
+    }
+  }
+
+  private void clearIfEmpty() {
+    if (mNumPairs <= 0) {
+      mNumPairs = 0;
+      mFingerprints = null;
+      mCounts = null;
+      mSlotsUsed = 0;
+      mRanges.clear();
+    }
+  }
+
+  /**
+   * @return a non-zero 32-bit fingerprint of the pair, from a 64-bit FNV-1a hash
+   */
+  private static int fingerprint(String key, String value) {
+    long h = 0xcbf29ce484222325L;
+    for (int i = 0; i < key.length(); i++) {
+      h = (h ^ key.charAt(i)) * 0x100000001b3L;
+    }
+    // Separate key and value, so ("ab", "c") and ("a", "bc") differ
+    h = (h ^ 0xffff) * 0x100000001b3L;
+    for (int i = 0; i < value.length(); i++) {
+      h = (h ^ value.charAt(i)) * 0x100000001b3L;
+    }
+    h ^= h >>> 33;
+    h *= 0xff51afd7ed558ccdL;
+    h ^= h >>> 33;
+    int fingerprint = (int) (h >>> 32);
+    return fingerprint == 0 ? 1 : fingerprint;
+  }
+
+  private static int home(int fingerprint, int mask) {
+    return (fingerprint * 0x9E3779B9) & mask;
+  }
+
+  private static Double parseNumber(String value) {
+    try {
+      return Double.valueOf(value.trim());
+    } catch (NumberFormatException e) {
+      return null;
+    }
+  }
+}
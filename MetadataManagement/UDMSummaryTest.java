@@ -0,0 +1,176 @@
+/*
+ * The Alluxio Open Foundation licenses this work under the Apache License, version 2.0
+ * (the "License"). You may not use this work except in compliance with the License, which is
+ * available at www.apache.org/licenses/LICENSE-2.0
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied, as more fully set forth in the License.
+ *
+ * See the NOTICE file distributed with this work for information regarding copyright ownership.
+ */
+
+package alluxio.master.file.meta;
+
+import org.junit.Assert;
+import org.junit.Test;
+
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.HashMap;
+import java.util.Map;
+
+/**
+ * Unit tests for {@link UDMSummary}.
+ */
+public final class UDMSummaryTest {
+  private static Map<String, String> udm(String... pairs) {
+    Map<String, String> udm = new HashMap<>();
+    for (int i = 0; i < pairs.length; i += 2) {
+      udm.put(pairs[i], pairs[i + 1]);
+    }
+    return udm;
+  }
+
+  private static boolean mightContain(UDMSummary summary, String key, String value) {
+    return summary.mightContain(Collections.singletonList(key), Collections.singletonList(value));
+  }
+
+  /**
+   * Tests that a summary matches the pairs it holds and prunes other pairs and ranges.
+   */
+  @Test
+  public void pruneAndNoPrune() {
+    UDMSummary summary = new UDMSummary();
+    Assert.assertTrue(summary.isEmpty());
+    Assert.assertEquals(0, summary.getCapacity());
+
+    summary.add(udm("owner", "alice", "size", "10"));
+    summary.add(udm("owner", "bob", "size", "20"));
+    Assert.assertTrue(mightContain(summary, "owner", "alice"));
+    Assert.assertTrue(mightContain(summary, "size", "20"));
+    Assert.assertTrue(summary.mightContain(Arrays.asList("owner", "size"),
+        Arrays.asList("bob", "20")));
+    Assert.assertFalse(mightContain(summary, "owner", "carol"));
+    Assert.assertFalse(mightContain(summary, "size", "30"));
+    Assert.assertFalse(mightContain(summary, "size", "5"));
+    Assert.assertFalse(mightContain(summary, "group", "alice"));
+  }
+
+  /**
+   * Tests that the table grows with the pairs, so absent pairs are still pruned.
+   */
+  @Test
+  public void manyPairs() {
+    UDMSummary summary = new UDMSummary();
+    for (int i = 0; i < 100000; i++) {
+      summary.add(udm("key" + (i % 100), "value" + i));
+    }
+    Assert.assertTrue(summary.getCapacity() >= 2 * 100000);
+    for (int i = 0; i < 100000; i++) {
+      Assert.assertTrue(mightContain(summary, "key" + (i % 100), "value" + i));
+    }
+    int falsePositives = 0;
+    for (int i = 100000; i < 200000; i++) {
+      if (mightContain(summary, "key" + (i % 100), "value" + i)) {
+        falsePositives++;
+      }
+    }
+    Assert.assertTrue(falsePositives < 10);
+  }
+
+  /**
+   * Tests that removing files forgets their pairs and shrinks the table.
+   */
+  @Test
+  public void delete() {
+    UDMSummary summary = new UDMSummary();
+    for (int i = 0; i < 1000; i++) {
+      summary.add(udm("id", Integer.toString(i), "kind", "data"));
+    }
+    int capacity = summary.getCapacity();
+    for (int i = 0; i < 990; i++) {
+      summary.remove(udm("id", Integer.toString(i), "kind", "data"));
+    }
+    Assert.assertTrue(summary.getCapacity() < capacity);
+    for (int i = 0; i < 990; i++) {
+      Assert.assertFalse(mightContain(summary, "id", Integer.toString(i)));
+    }
+    for (int i = 990; i < 1000; i++) {
+      Assert.assertTrue(mightContain(summary, "id", Integer.toString(i)));
+    }
+    Assert.assertTrue(mightContain(summary, "kind", "data"));
+    for (int i = 990; i < 1000; i++) {
+      summary.remove(udm("id", Integer.toString(i), "kind", "data"));
+    }
+    Assert.assertTrue(summary.isEmpty());
+    Assert.assertEquals(0, summary.getCapacity());
+    Assert.assertFalse(mightContain(summary, "kind", "data"));
+  }
+
+  /**
+   * Tests that a pair shared by many files stays until the last of them is removed, however
+   * many files share it.
+   */
+  @Test
+  public void noSaturation() {
+    UDMSummary summary = new UDMSummary();
+    for (int i = 0; i < 1000; i++) {
+      summary.add(udm("kind", "data", "id", Integer.toString(i)));
+    }
+    for (int i = 0; i < 999; i++) {
+      summary.remove(udm("kind", "data", "id", Integer.toString(i)));
+      Assert.assertTrue(mightContain(summary, "kind", "data"));
+    }
+    summary.remove(udm("kind", "data", "id", "999"));
+    Assert.assertFalse(mightContain(summary, "kind", "data"));
+  }
+
+  /**
+   * Tests that the attributes of projected datasets are summarized like the UDM of files, so a
+   * subtree whose datasets lack a queried pair is ruled out.
+   */
+  @Test
+  public void projectedDatasets() {
+    UDMSummary summary = new UDMSummary();
+    summary.add(udm("owner", "alice"));
+    summary.add(udm("h5.dtype", "H5T_FLOAT", "Temperature", "273.15"));
+    summary.add(udm("h5.dtype", "H5T_INTEGER", "Temperature", "300"));
+    Assert.assertTrue(mightContain(summary, "Temperature", "300"));
+    Assert.assertFalse(mightContain(summary, "Temperature", "400"));
+
+    summary.remove(udm("h5.dtype", "H5T_INTEGER", "Temperature", "300"));
+    Assert.assertFalse(mightContain(summary, "Temperature", "300"));
+    Assert.assertTrue(mightContain(summary, "h5.dtype", "H5T_FLOAT"));
+    summary.remove(udm("h5.dtype", "H5T_FLOAT", "Temperature", "273.15"));
+    summary.remove(udm("owner", "alice"));
+    Assert.assertTrue(summary.isEmpty());
+  }
+
+  /**
+   * Tests that moving a subtree summary between two parents moves its pairs.
+   */
+  @Test
+  public void rename() {
+    UDMSummary src = new UDMSummary();
+    UDMSummary dst = new UDMSummary();
+    UDMSummary moved = new UDMSummary();
+    moved.add(udm("owner", "alice", "size", "100"));
+    src.add(udm("owner", "bob", "size", "1"));
+    src.merge(moved);
+    dst.add(udm("owner", "carol", "size", "2"));
+    Assert.assertTrue(mightContain(src, "owner", "alice"));
+    Assert.assertFalse(mightContain(dst, "owner", "alice"));
+
+    src.subtract(moved);
+    dst.merge(moved);
+    Assert.assertFalse(mightContain(src, "owner", "alice"));
+    Assert.assertTrue(mightContain(src, "owner", "bob"));
+    Assert.assertTrue(mightContain(dst, "owner", "alice"));
+    Assert.assertTrue(mightContain(dst, "size", "100"));
+    Assert.assertTrue(mightContain(dst, "owner", "carol"));
+
+    dst.subtract(moved);
+    dst.remove(udm("owner", "carol", "size", "2"));
+    Assert.assertTrue(dst.isEmpty());
+  }
+}
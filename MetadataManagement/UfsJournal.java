@@ -19,6 +19,7 @@ import alluxio.PropertyKey;
 import alluxio.master.journal.Journal;
 import alluxio.master.journal.JournalEntryStateMachine;
 import alluxio.master.journal.JournalReader;
+import alluxio.metrics.MetricsSystem;
 import alluxio.proto.journal.Journal.JournalEntry;
 import alluxio.underfs.UfsStatus;
 import alluxio.underfs.UnderFileSystem;
@@ -35,6 +36,7 @@ import alluxio.proto.journal.File.PersistDirectoryEntry;
 import alluxio.proto.journal.File.SetAttributeEntry;
 //import alluxio.proto.journal.File.StringPairEntry;
 
+import com.codahale.metrics.Counter;
 import com.google.common.base.Preconditions;
 import org.slf4j.Logger;
 import org.slf4j.LoggerFactory;
@@ -105,6 +107,9 @@ public class UfsJournal implements Journal {
    */
   private UfsJournalCheckpointThread mTailerThread;
 
+  /** Bytes of keys and values this journal has written to its EntryStore. */
+  private final Counter mEntryStoreBytes;
+
   /** The current Database that manages the entry as KV pairs.*/
   private DB mEntryDB;
   /** Serializer that transforms entry to byte array.*/
@@ -151,6 +156,7 @@ public class UfsJournal implements Journal {
     mLogDir = URIUtils.appendPathOrDie(mLocation, LOG_DIRNAME);
     mCheckpointDir = URIUtils.appendPathOrDie(mLocation, CHECKPOINT_DIRNAME);
     mTmpDir = URIUtils.appendPathOrDie(mLocation, TMP_DIRNAME);
+    mEntryStoreBytes = getEntryStoreBytesCounter(new File(location.getPath()).getName());
     String storepath = location.getPath();
     LOG.info("DB Test: Init UfsJounalDB, Journal path: {}", storepath);
     File targetfile;
@@ -183,7 +189,7 @@ public class UfsJournal implements Journal {
       InodeFileEntry fileentry = entry.getInodeFile();
       long fileid = fileentry.getId();
       tmpbuffer.putLong(fileid);
-      mEntryDB.put(tmpbuffer.array(), mSerializer.serialize(entry));
+      putEntry(tmpbuffer.array(), mSerializer.serialize(entry));
       LOG.info("DB Test: put KV pair to EntryDB once with fileid {}", fileid);
       LOG.info("File Name: {}", fileentry.getName());
       LOG.info("BlockIds: {}", fileentry.getBlocksList());
@@ -196,13 +202,13 @@ public class UfsJournal implements Journal {
     } else if (entry.hasInodeDirectory()) {
       long dirid = entry.getInodeDirectory().getId();
       tmpbuffer.putLong(dirid);
-      mEntryDB.put(tmpbuffer.array(), mSerializer.serialize(entry));
+      putEntry(tmpbuffer.array(), mSerializer.serialize(entry));
       LOG.info("DB Test: put DIR KV pair to EntryDB once with directory id: {}", dirid);
     } else if (entry.hasDeleteFile()) {
       long fileid = entry.getDeleteFile().getId();
       LOG.info("DB Test: delete KV pair from EntryDB once with fileid/directoryid: {}", fileid);
       tmpbuffer.putLong(fileid);
-      mEntryDB.delete(tmpbuffer.array());
+      deleteEntry(tmpbuffer.array());
     } else if (entry.hasInodeLastModificationTime()) {
       InodeLastModificationTimeEntry modTimeEntry = entry.getInodeLastModificationTime();
       long fileid = modTimeEntry.getId();
@@ -211,7 +217,7 @@ public class UfsJournal implements Journal {
       JournalEntry oldentry = (JournalEntry) mSerializer.deserialize(oldEntryValue);
       JournalEntry newentry =
           oldentry.toBuilder().setInodeLastModificationTime(modTimeEntry).build();
-      mEntryDB.put(tmpbuffer.array(), mSerializer.serialize(newentry));
+      putEntry(tmpbuffer.array(), mSerializer.serialize(newentry));
       LOG.info("DB Test: Update InodeLastModificationTime to EntryDB");
     } else if (entry.hasPersistDirectory()) {
       PersistDirectoryEntry typedEntry = entry.getPersistDirectory();
@@ -220,7 +226,7 @@ public class UfsJournal implements Journal {
       byte[] oldEntryValue = mEntryDB.get(tmpbuffer.array());
       JournalEntry oldentry = (JournalEntry) mSerializer.deserialize(oldEntryValue);
       JournalEntry newentry = oldentry.toBuilder().setPersistDirectory(typedEntry).build();
-      mEntryDB.put(tmpbuffer.array(), mSerializer.serialize(newentry));
+      putEntry(tmpbuffer.array(), mSerializer.serialize(newentry));
       LOG.info("DB Test: Update PersistDirectory to EntryDB");
     } else if (entry.hasCompleteFile()) {
       CompleteFileEntry compEntry = entry.getCompleteFile();
@@ -234,7 +240,7 @@ public class UfsJournal implements Journal {
       byte[] oldEntryValue = mEntryDB.get(tmpbuffer.array());
       JournalEntry oldentry = (JournalEntry) mSerializer.deserialize(oldEntryValue);
       JournalEntry newentry = oldentry.toBuilder().setCompleteFile(compEntry).build();
-      mEntryDB.put(tmpbuffer.array(), mSerializer.serialize(newentry));
+      putEntry(tmpbuffer.array(), mSerializer.serialize(newentry));
       LOG.info("DB Test: Update CompleteFile to EntryDB");
     } else if (entry.hasSetAttribute()) {
       SetAttributeEntry saEntry = entry.getSetAttribute();
@@ -247,7 +253,7 @@ public class UfsJournal implements Journal {
         newentry.setUDM(entry.getUDM());
         LOG.info("DB Test: Set UDM to SAEntry: {}", entry.getUDM());
       }
-      mEntryDB.put(tmpbuffer.array(), mSerializer.serialize(newentry));
+      putEntry(tmpbuffer.array(), mSerializer.serialize(newentry));
       LOG.info("DB Test: SetAttribute to EntryDB");
     } else if (entry.hasRename()) {
       long fileid = entry.getRename().getId();
@@ -256,24 +262,24 @@ public class UfsJournal implements Journal {
       byte[] oldEntryValue = mEntryDB.get(tmpbuffer.array());
       JournalEntry oldentry = (JournalEntry) mSerializer.deserialize(oldEntryValue);
       JournalEntry newentry = oldentry.toBuilder().setRename(entry.getRename()).build();
-      mEntryDB.put(tmpbuffer.array(), mSerializer.serialize(newentry));
+      putEntry(tmpbuffer.array(), mSerializer.serialize(newentry));
       LOG.info("DB Test: Rename Entry to EntryDB, fileid {}", fileid);
     } else if (entry.hasInodeDirectoryIdGenerator()) {
       long mContainerId = entry.getInodeDirectoryIdGenerator().getContainerId();
       tmpbuffer.putLong(mContainerId);
-      mEntryDB.put(tmpbuffer.array(), mSerializer.serialize(entry));
+      putEntry(tmpbuffer.array(), mSerializer.serialize(entry));
       LOG.info("DB Test: Add DirectoryIdGenerator {}, to EntryDB", mContainerId);
     } else if (entry.hasReinitializeFile()) {
       String path = entry.getReinitializeFile().getPath();
-      mEntryDB.put(bytes(path), mSerializer.serialize(entry));
+      putEntry(bytes(path), mSerializer.serialize(entry));
       LOG.info("DB Test: Add ReinitializeFile info {}, to EntryDB", path);
     } else if (entry.hasAddMountPoint()) {
       String mountPath = entry.getAddMountPoint().getAlluxioPath();
-      mEntryDB.put(bytes(mountPath), mSerializer.serialize(entry));
+      putEntry(bytes(mountPath), mSerializer.serialize(entry));
       LOG.info("DB Test: Add mount point {}, to EntryDB", mountPath);
     } else if (entry.hasDeleteMountPoint()) {
       String mountPath = entry.getDeleteMountPoint().getAlluxioPath();
-      mEntryDB.delete(bytes(mountPath));
+      deleteEntry(bytes(mountPath));
       LOG.info("DB Test: Delete mount point {}, to EntryDB", mountPath);
     } else if (entry.hasAsyncPersistRequest()) {
       AsyncPersistRequestEntry asyncEntry = entry.getAsyncPersistRequest();
@@ -282,28 +288,47 @@ public class UfsJournal implements Journal {
       byte[] oldEntryValue = mEntryDB.get(tmpbuffer.array());
       JournalEntry oldentry = (JournalEntry) mSerializer.deserialize(oldEntryValue);
       JournalEntry newentry = oldentry.toBuilder().setAsyncPersistRequest(asyncEntry).build();
-      mEntryDB.put(tmpbuffer.array(), mSerializer.serialize(newentry));
+      putEntry(tmpbuffer.array(), mSerializer.serialize(newentry));
       LOG.info("DB Test: Add AsyncPersistRequest to EntryDB");
     }
     //Wrtie Block entry to EntryDB
     if (entry.hasBlockInfo()) {
       long bid = entry.getBlockInfo().getBlockId();
       tmpbuffer.putLong(bid);
-      mEntryDB.put(tmpbuffer.array(), mSerializer.serialize(entry));
+      putEntry(tmpbuffer.array(), mSerializer.serialize(entry));
       LOG.info("DB Test: Write Block entry to EntryDB with blockID {}", bid);
     } else if (entry.hasDeleteBlock()) {
       long bid = entry.getDeleteBlock().getBlockId();
       tmpbuffer.putLong(bid);
-      mEntryDB.delete(tmpbuffer.array());
+      deleteEntry(tmpbuffer.array());
       LOG.info("DB Test: Delete Block entry from EntryDB with blockID {}", bid);
     } else if (entry.hasBlockContainerIdGenerator()) {
       long cid = (entry.getBlockContainerIdGenerator()).getNextContainerId();
       tmpbuffer.putLong(cid);
-      mEntryDB.put(tmpbuffer.array(), mSerializer.serialize(entry));
+      putEntry(tmpbuffer.array(), mSerializer.serialize(entry));
       LOG.info("DB Test: Write BlockContainerIdGenerator to EntryDB with blockID {}", cid);
     }
   }
 
+  /**
+   * @param masterName the name of a master, which names its journal folder
+   * @return the counter of the bytes the journal of the master writes to its EntryStore, which is
+   *         where journal writes go instead of the log files
+   */
+  public static Counter getEntryStoreBytesCounter(String masterName) {
+    return MetricsSystem.masterCounter("JournalEntryStoreBytes." + masterName);
+  }
+
+  private void putEntry(byte[] key, byte[] value) {
+    mEntryDB.put(key, value);
+    mEntryStoreBytes.inc(key.length + value.length);
+  }
+
+  private void deleteEntry(byte[] key) {
+    mEntryDB.delete(key);
+    mEntryStoreBytes.inc(key.length);
+  }
+
   @Override
   public void flush() throws IOException {
     writer().flush();
@@ -321,6 +346,7 @@ public class UfsJournal implements Journal {
    */
   public void start() throws IOException {
     mMaster.resetState();
+    openCheckpointImage();
     mTailerThread = new UfsJournalCheckpointThread(mMaster, this);
     mTailerThread.start();
   }
@@ -350,6 +376,7 @@ public class UfsJournal implements Journal {
     mWriter.close();
     mWriter = null;
     mMaster.resetState();
+    openCheckpointImage();
     mTailerThread = new UfsJournalCheckpointThread(mMaster, this);
     mTailerThread.start();
   }
@@ -375,6 +402,15 @@ public class UfsJournal implements Journal {
    */
   public UfsJournalCheckpointWriter getCheckpointWriter(long checkpointSequenceNumber)
       throws IOException {
+    if (mMaster instanceof CheckpointImage) {
+      CheckpointImage image = (CheckpointImage) mMaster;
+      UfsJournalFile checkpoint = UfsJournalSnapshot.getSnapshot(this).getLatestCheckpoint();
+      if (checkpoint != null) {
+        image.deleteCheckpointImages(checkpoint.getEnd());
+      }
+      // Written first, so a checkpoint never commits without its image
+      image.writeCheckpointImage(checkpointSequenceNumber);
+    }
     return new UfsJournalCheckpointWriter(this, checkpointSequenceNumber);
   }
 
@@ -428,6 +464,20 @@ public class UfsJournal implements Journal {
         .toString());
   }
 
+  /**
+   * Lets the master map the image of the latest checkpoint before the checkpoint is replayed.
+   */
+  private void openCheckpointImage() throws IOException {
+    if (mMaster instanceof CheckpointImage) {
+      CheckpointImage image = (CheckpointImage) mMaster;
+      UfsJournalFile checkpoint = UfsJournalSnapshot.getSnapshot(this).getLatestCheckpoint();
+      image.openCheckpointImage(checkpoint == null ? -1 : checkpoint.getEnd());
+      if (checkpoint != null) {
+        image.deleteCheckpointImages(checkpoint.getEnd());
+      }
+    }
+  }
+
   /**
    * @return the log directory location
    */
@@ -525,6 +575,41 @@ public class UfsJournal implements Journal {
     return "UfsJournal(" + mLocation + ")";
   }
 
+  /**
+   * Implemented by a master which keeps state that checkpoint entries do not carry in an image
+   * file written with every checkpoint. An image belongs to the checkpoint with the same sequence
+   * number and is only used to replay that checkpoint. The checkpoint writer commits outside of
+   * this class, so the images of earlier checkpoints are deleted once a later checkpoint shows
+   * up as committed, when the next checkpoint starts or the journal is replayed.
+   */
+  public interface CheckpointImage {
+    /**
+     * Writes the image of a checkpoint before the checkpoint itself is written. It must not
+     * replace the image of the latest committed checkpoint, which is replayed until this
+     * checkpoint commits.
+     *
+     * @param sequenceNumber the sequence number of the checkpoint
+     * @throws IOException if the image cannot be written, which fails the checkpoint
+     */
+    void writeCheckpointImage(long sequenceNumber) throws IOException;
+
+    /**
+     * Maps the image of the checkpoint about to be replayed. The master releases it once the
+     * checkpoint entries are replayed.
+     *
+     * @param sequenceNumber the sequence number of the checkpoint, or -1 if there is none
+     * @throws IOException if the image is missing or cannot be read
+     */
+    void openCheckpointImage(long sequenceNumber) throws IOException;
+
+    /**
+     * Deletes the images of the checkpoints before a committed one, which are never replayed.
+     *
+     * @param sequenceNumber the sequence number of the latest committed checkpoint
+     */
+    void deleteCheckpointImages(long sequenceNumber);
+  }
+
   @Override
   public void close() throws IOException {
     mEntryDB.close();
@@ -1,8 +1,17 @@
 #!/bin/bash
 #scp UfsJournalLogWriter.java cn17633:/home/condor/alluxio/core/server/common/src/main/java/alluxio/master/journal/ufs/
 #scp JavaSerializer.java cn17633:/home/condor/alluxio/core/server/common/src/main/java/alluxio/master/journal/ufs/
-#scp UfsJournal.java cn17633:/home/condor/alluxio/core/server/common/src/main/java/alluxio/master/journal/ufs/
+scp UfsJournal.java cn17633:/home/condor/alluxio/core/server/common/src/main/java/alluxio/master/journal/ufs/
 scp DefaultFileSystemMaster.java cn17633:/home/condor/alluxio/core/server/master/src/main/java/alluxio/master/file/
+scp FileSystemMasterBenchmark.java cn17633:/home/condor/alluxio/core/server/master/src/main/java/alluxio/master/file/
+scp BlockZoneMapStore.java cn17633:/home/condor/alluxio/core/server/master/src/main/java/alluxio/master/file/
+scp BlockZoneMapStoreTest.java cn17633:/home/condor/alluxio/core/server/master/src/test/java/alluxio/master/file/
+scp UDMSummary.java cn17633:/home/condor/alluxio/core/server/master/src/main/java/alluxio/master/file/meta/
+scp UDMSummaryTest.java cn17633:/home/condor/alluxio/core/server/master/src/test/java/alluxio/master/file/meta/
+scp HDF5Projection.java cn17633:/home/condor/alluxio/core/server/master/src/main/java/alluxio/master/file/meta/
+scp HDF5ProjectionTest.java cn17633:/home/condor/alluxio/core/server/master/src/test/java/alluxio/master/file/meta/
+scp UDMImage.java cn17633:/home/condor/alluxio/core/server/master/src/main/java/alluxio/master/file/meta/
+scp UDMImageTest.java cn17633:/home/condor/alluxio/core/server/master/src/test/java/alluxio/master/file/meta/
 #scp DefaultBlockMaster.java cn17633:/home/condor/alluxio/core/server/master/src/main/java/alluxio/master/block/
 scp File.java cn17633:/home/condor/alluxio/core/protobuf/src/main/java/alluxio/proto/journal/
 #scp Journal.java cn17633:/home/condor/alluxio/core/protobuf/src/main/java/alluxio/proto/journal/